@@ -0,0 +1,462 @@
+#include "column.h"
+#include <stdexcept>
+#include <typeinfo>
+
+ColumnType parse_column_type(const std::string& type_name) {
+    if (type_name == "int32" || type_name == "int") {
+        return ColumnType::Int32;
+    }
+    if (type_name == "string") {
+        return ColumnType::String;
+    }
+    if (type_name == "bool") {
+        return ColumnType::Bool;
+    }
+    throw std::runtime_error("Unsupported column type: " + type_name);
+}
+
+Column::Column(ColumnType type) : column_type(type) {}
+
+Column::Column(const Column& other) {
+    *this = other;
+}
+
+Column::Column(Column&& other) noexcept {
+    *this = std::move(other);
+}
+
+Column& Column::operator=(const Column& other) {
+    if (this == &other) {
+        return *this;
+    }
+    column_type = other.column_type;
+    row_count = other.row_count;
+    null_bits = other.null_bits;
+    int_values = other.int_values;
+    bool_bits = other.bool_bits;
+    string_offsets = other.string_offsets;
+    string_lengths = other.string_lengths;
+    string_data = other.string_data;
+    mapping = other.mapping;
+    if (mapping) {
+        // Отображённые данные общие, копируются только указатели
+        null_view = other.null_view;
+        int_view = other.int_view;
+        bool_view = other.bool_view;
+        offset_view = other.offset_view;
+        length_view = other.length_view;
+        char_view = other.char_view;
+        char_count = other.char_count;
+    }
+    else {
+        refresh_views();
+    }
+    return *this;
+}
+
+Column& Column::operator=(Column&& other) noexcept {
+    if (this == &other) {
+        return *this;
+    }
+    column_type = other.column_type;
+    row_count = other.row_count;
+    null_bits = std::move(other.null_bits);
+    int_values = std::move(other.int_values);
+    bool_bits = std::move(other.bool_bits);
+    string_offsets = std::move(other.string_offsets);
+    string_lengths = std::move(other.string_lengths);
+    string_data = std::move(other.string_data); // буфер строки может быть встроенным, поэтому view пересчитываются
+    mapping = std::move(other.mapping);
+    if (mapping) {
+        null_view = other.null_view;
+        int_view = other.int_view;
+        bool_view = other.bool_view;
+        offset_view = other.offset_view;
+        length_view = other.length_view;
+        char_view = other.char_view;
+        char_count = other.char_count;
+    }
+    else {
+        refresh_views();
+    }
+    other.clear();
+    return *this;
+}
+
+void Column::refresh_views() {
+    null_view = null_bits.data();
+    int_view = int_values.data();
+    bool_view = bool_bits.data();
+    offset_view = string_offsets.data();
+    length_view = string_lengths.data();
+    char_view = string_data.data();
+    char_count = string_data.size();
+}
+
+void Column::throw_out_of_bounds() {
+    throw std::runtime_error("Corrupted string column: value out of bounds.");
+}
+
+std::any Column::get(size_t row) const {
+    if (is_null(row)) {
+        return std::any();
+    }
+    switch (column_type) {
+    case ColumnType::Int32:
+        return static_cast<int>(get_int(row));
+    case ColumnType::String:
+        return std::string(get_string(row));
+    case ColumnType::Bool:
+        return get_bool(row);
+    }
+    return std::any();
+}
+
+bool Column::accepts(const std::any& value) const {
+    if (!value.has_value()) {
+        return true;
+    }
+    switch (column_type) {
+    case ColumnType::Int32:
+        return value.type() == typeid(int);
+    case ColumnType::String:
+        return value.type() == typeid(std::string);
+    case ColumnType::Bool:
+        return value.type() == typeid(bool);
+    }
+    return false;
+}
+
+void Column::push_null_bit(bool is_null_value) {
+    if ((row_count & 63) == 0) {
+        null_bits.push_back(0);
+        if (column_type == ColumnType::Bool) {
+            bool_bits.push_back(0);
+        }
+    }
+    if (is_null_value) {
+        null_bits[row_count >> 6] |= uint64_t(1) << (row_count & 63);
+    }
+}
+
+void Column::set_null_bit(size_t row, bool is_null_value) {
+    uint64_t mask = uint64_t(1) << (row & 63);
+    if (is_null_value) {
+        null_bits[row >> 6] |= mask;
+    }
+    else {
+        null_bits[row >> 6] &= ~mask;
+    }
+}
+
+void Column::set_bool_bit(size_t row, bool value) {
+    uint64_t mask = uint64_t(1) << (row & 63);
+    if (value) {
+        bool_bits[row >> 6] |= mask;
+    }
+    else {
+        bool_bits[row >> 6] &= ~mask;
+    }
+}
+
+void Column::append_null() {
+    prepare_write();
+    push_null_bit(true);
+    switch (column_type) {
+    case ColumnType::Int32:
+        int_values.push_back(0);
+        break;
+    case ColumnType::String:
+        string_offsets.push_back(string_data.size());
+        string_lengths.push_back(0);
+        break;
+    case ColumnType::Bool:
+        break; // бит уже обнулён
+    }
+    ++row_count;
+    refresh_views();
+}
+
+void Column::append_int(int32_t value) {
+    prepare_write();
+    if (column_type != ColumnType::Int32) {
+        throw std::runtime_error("Type mismatch: column is not int32.");
+    }
+    push_null_bit(false);
+    int_values.push_back(value);
+    ++row_count;
+    refresh_views();
+}
+
+void Column::append_bool(bool value) {
+    prepare_write();
+    if (column_type != ColumnType::Bool) {
+        throw std::runtime_error("Type mismatch: column is not bool.");
+    }
+    push_null_bit(false);
+    set_bool_bit(row_count, value);
+    ++row_count;
+    refresh_views();
+}
+
+void Column::append_string(std::string_view value) {
+    prepare_write();
+    if (column_type != ColumnType::String) {
+        throw std::runtime_error("Type mismatch: column is not string.");
+    }
+    push_null_bit(false);
+    string_offsets.push_back(string_data.size());
+    string_lengths.push_back(static_cast<uint32_t>(value.size()));
+    string_data.append(value.data(), value.size());
+    ++row_count;
+    refresh_views();
+}
+
+void Column::append_from(const Column& source, size_t row) {
+    if (source.is_null(row)) {
+        append_null();
+        return;
+    }
+    switch (source.column_type) {
+    case ColumnType::Int32:
+        append_int(source.get_int(row));
+        break;
+    case ColumnType::String:
+        append_string(source.get_string(row));
+        break;
+    case ColumnType::Bool:
+        append_bool(source.get_bool(row));
+        break;
+    }
+}
+
+void Column::append(const std::any& value) {
+    if (!value.has_value()) {
+        append_null();
+        return;
+    }
+    if (!accepts(value)) {
+        throw std::runtime_error("Type mismatch: unexpected value type " + std::string(value.type().name()));
+    }
+    switch (column_type) {
+    case ColumnType::Int32:
+        append_int(std::any_cast<int>(value));
+        break;
+    case ColumnType::String:
+        append_string(std::any_cast<const std::string&>(value));
+        break;
+    case ColumnType::Bool:
+        append_bool(std::any_cast<bool>(value));
+        break;
+    }
+}
+
+void Column::set(size_t row, const std::any& value) {
+    if (row >= row_count) {
+        throw std::out_of_range("Row index out of range.");
+    }
+    if (!accepts(value)) {
+        throw std::runtime_error("Type mismatch: unexpected value type " + std::string(value.type().name()));
+    }
+    prepare_write();
+    set_null_bit(row, !value.has_value());
+
+    switch (column_type) {
+    case ColumnType::Int32:
+        int_values[row] = value.has_value() ? std::any_cast<int>(value) : 0;
+        break;
+    case ColumnType::Bool:
+        set_bool_bit(row, value.has_value() && std::any_cast<bool>(value));
+        break;
+    case ColumnType::String: {
+        if (!value.has_value()) {
+            string_lengths[row] = 0;
+            break;
+        }
+        const auto& str = std::any_cast<const std::string&>(value);
+        // Если новая строка не длиннее старой, пишем на её место, иначе в конец буфера.
+        if (str.size() > string_lengths[row]) {
+            string_offsets[row] = string_data.size();
+            string_data.append(str);
+        }
+        else {
+            string_data.replace(string_offsets[row], str.size(), str);
+        }
+        string_lengths[row] = static_cast<uint32_t>(str.size());
+        break;
+    }
+    }
+    refresh_views();
+}
+
+void Column::reserve(size_t rows) {
+    prepare_write();
+    null_bits.reserve((rows + 63) / 64);
+    switch (column_type) {
+    case ColumnType::Int32:
+        int_values.reserve(rows);
+        break;
+    case ColumnType::String:
+        string_offsets.reserve(rows);
+        string_lengths.reserve(rows);
+        break;
+    case ColumnType::Bool:
+        bool_bits.reserve((rows + 63) / 64);
+        break;
+    }
+    refresh_views();
+}
+
+void Column::clear() {
+    row_count = 0;
+    mapping.reset();
+    null_bits.clear();
+    int_values.clear();
+    bool_bits.clear();
+    string_offsets.clear();
+    string_lengths.clear();
+    string_data.clear();
+    refresh_views();
+}
+
+void Column::save(storage::BinaryWriter& out, const std::vector<uint64_t>* deleted) const {
+    size_t words = (row_count + 63) / 64;
+    const uint64_t* nulls = null_view;
+    std::vector<uint64_t> nulls_with_deleted;
+    if (deleted) {
+        nulls_with_deleted.assign(null_view, null_view + words);
+        for (size_t i = 0; i < nulls_with_deleted.size() && i < deleted->size(); ++i) {
+            nulls_with_deleted[i] |= (*deleted)[i];
+        }
+        nulls = nulls_with_deleted.data();
+    }
+    out.write_block(nulls, words * sizeof(uint64_t));
+
+    switch (column_type) {
+    case ColumnType::Int32:
+        out.write_block(int_view, row_count * sizeof(int32_t));
+        break;
+    case ColumnType::Bool:
+        out.write_block(bool_view, words * sizeof(uint64_t));
+        break;
+    case ColumnType::String: {
+        // Строки записываются подряд, без мусора от перезаписанных значений
+        std::vector<uint64_t> offsets(row_count);
+        std::vector<uint32_t> lengths(row_count, 0);
+        std::string chars;
+        chars.reserve(char_count);
+        for (size_t row = 0; row < row_count; ++row) {
+            offsets[row] = chars.size();
+            if (!(nulls[row >> 6] >> (row & 63) & 1)) {
+                std::string_view value = get_string(row);
+                lengths[row] = static_cast<uint32_t>(value.size());
+                chars.append(value.data(), value.size());
+            }
+        }
+        out.write_block(offsets);
+        out.write_block(lengths);
+        out.write_block(chars);
+        break;
+    }
+    }
+}
+
+namespace {
+
+// Каждое значение строкового столбца должно лежать внутри блока символов
+void check_string_bounds(const uint64_t* offsets, const uint32_t* lengths, size_t rows, size_t char_count) {
+    for (size_t row = 0; row < rows; ++row) {
+        if (offsets[row] > char_count || lengths[row] > char_count - offsets[row]) {
+            throw std::runtime_error("Corrupted string column: value out of bounds.");
+        }
+    }
+}
+
+} // namespace
+
+void Column::load(storage::MemoryReader& in, size_t rows) {
+    clear();
+    size_t words = (rows + 63) / 64;
+    const uint64_t* nulls = in.read_array<uint64_t>(words);
+    null_bits.assign(nulls, nulls + words);
+
+    switch (column_type) {
+    case ColumnType::Int32: {
+        const int32_t* values = in.read_array<int32_t>(rows);
+        int_values.assign(values, values + rows);
+        break;
+    }
+    case ColumnType::Bool: {
+        const uint64_t* bits = in.read_array<uint64_t>(words);
+        bool_bits.assign(bits, bits + words);
+        break;
+    }
+    case ColumnType::String: {
+        const uint64_t* offsets = in.read_array<uint64_t>(rows);
+        const uint32_t* lengths = in.read_array<uint32_t>(rows);
+        std::string_view chars = in.read_block();
+        check_string_bounds(offsets, lengths, rows, chars.size());
+        string_offsets.assign(offsets, offsets + rows);
+        string_lengths.assign(lengths, lengths + rows);
+        string_data.assign(chars.data(), chars.size());
+        break;
+    }
+    }
+    row_count = rows;
+    refresh_views();
+}
+
+void Column::skip(storage::MemoryReader& in) const {
+    size_t blocks = (column_type == ColumnType::String) ? 4 : 2;
+    for (size_t i = 0; i < blocks; ++i) {
+        in.read_block(false);
+    }
+}
+
+void Column::attach(storage::MemoryReader& in, size_t rows, std::shared_ptr<const storage::MappedFile> file) {
+    clear();
+    size_t words = (rows + 63) / 64;
+    null_view = in.read_array<uint64_t>(words, false);
+
+    switch (column_type) {
+    case ColumnType::Int32:
+        int_view = in.read_array<int32_t>(rows, false);
+        break;
+    case ColumnType::Bool:
+        bool_view = in.read_array<uint64_t>(words, false);
+        break;
+    case ColumnType::String: {
+        offset_view = in.read_array<uint64_t>(rows, false);
+        length_view = in.read_array<uint32_t>(rows, false);
+        std::string_view chars = in.read_block(false);
+        char_view = chars.data();
+        char_count = chars.size();
+        break;
+    }
+    }
+    row_count = rows;
+    mapping = std::move(file);
+}
+
+void Column::materialize() {
+    if (!mapping) {
+        return;
+    }
+    size_t words = (row_count + 63) / 64;
+    null_bits.assign(null_view, null_view + words);
+    switch (column_type) {
+    case ColumnType::Int32:
+        int_values.assign(int_view, int_view + row_count);
+        break;
+    case ColumnType::Bool:
+        bool_bits.assign(bool_view, bool_view + words);
+        break;
+    case ColumnType::String:
+        string_offsets.assign(offset_view, offset_view + row_count);
+        string_lengths.assign(length_view, length_view + row_count);
+        string_data.assign(char_view, char_count);
+        break;
+    }
+    mapping.reset();
+    refresh_views();
+}
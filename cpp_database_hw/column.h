@@ -0,0 +1,122 @@
+#pragma once
+#ifndef COLUMN_H
+#define COLUMN_H
+
+#include <any>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "storage_format.h"
+#include "mapped_file.h"
+
+/**
+ * @brief Физический тип данных столбца.
+ */
+enum class ColumnType {
+    Int32,
+    String,
+    Bool
+};
+
+/**
+ * @brief Преобразует имя типа из схемы ("int32", "string", "bool") в ColumnType.
+ */
+ColumnType parse_column_type(const std::string& type_name);
+
+/**
+ * @class Column
+ * Колоночное хранилище: один непрерывный типизированный массив на столбец
+ * и битовая карта NULL. Строки хранятся в общем буфере символов,
+ * на каждую строку таблицы приходится смещение и длина.
+ *
+ * Чтение идёт через указатели на массивы, которые указывают либо на собственные
+ * векторы столбца, либо прямо в отображённый файл (attach). Отображённые данные
+ * копируются в собственные векторы при первом изменении столбца.
+ */
+class Column {
+public:
+    explicit Column(ColumnType type = ColumnType::Int32); ///< Пустой столбец заданного типа.
+    Column(const Column& other);
+    Column(Column&& other) noexcept;
+    Column& operator=(const Column& other);
+    Column& operator=(Column&& other) noexcept;
+
+    ColumnType type() const { return column_type; }
+    size_t size() const { return row_count; }
+
+    // Доступ к значениям по номеру строки.
+    bool is_null(size_t row) const { return (null_view[row >> 6] >> (row & 63)) & 1; }
+    int32_t get_int(size_t row) const { return int_view[row]; }
+    bool get_bool(size_t row) const { return (bool_view[row >> 6] >> (row & 63)) & 1; }
+    std::string_view get_string(size_t row) const {
+        // Границы проверяются при каждом чтении: у отображённого столбца они не проверялись при подключении
+        if (offset_view[row] > char_count || length_view[row] > char_count - offset_view[row]) {
+            throw_out_of_bounds();
+        }
+        return std::string_view(char_view + offset_view[row], length_view[row]);
+    }
+
+    // Значение в виде std::any (пустой std::any для NULL).
+    std::any get(size_t row) const;
+
+    // Добавление значений в конец столбца.
+    void append(const std::any& value);
+    void append_null();
+    void append_int(int32_t value);
+    void append_bool(bool value);
+    void append_string(std::string_view value);
+    void append_from(const Column& source, size_t row); // Копирование значения из столбца того же типа
+
+    // Замена значения в существующей строке.
+    void set(size_t row, const std::any& value);
+
+    // Проверяет, подходит ли значение std::any по типу (пустой std::any - NULL, подходит всегда).
+    bool accepts(const std::any& value) const;
+
+    void reserve(size_t rows);
+    void clear();
+
+    // Запись и чтение блоков столбца в бинарном формате.
+    // Строки, отмеченные в deleted, записываются как NULL.
+    void save(storage::BinaryWriter& out, const std::vector<uint64_t>* deleted) const;
+    void load(storage::MemoryReader& in, size_t rows); // С проверкой контрольных сумм и копированием
+    void skip(storage::MemoryReader& in) const;         // Пропуск блоков столбца без чтения данных
+
+    // Подключает столбец к блокам отображённого файла без копирования.
+    // Контрольные суммы не проверяются, а границы строк проверяет get_string при чтении значения,
+    // поэтому подключение не читает страницы данных заранее.
+    void attach(storage::MemoryReader& in, size_t rows, std::shared_ptr<const storage::MappedFile> file);
+    bool is_mapped() const { return mapping != nullptr; }
+    void materialize(); // Копирует отображённые данные в память столбца
+
+private:
+    ColumnType column_type;
+    size_t row_count = 0;
+
+    std::vector<uint64_t> null_bits;       // бит установлен - значение NULL
+    std::vector<int32_t> int_values;       // данные столбца int32
+    std::vector<uint64_t> bool_bits;       // данные столбца bool
+    std::vector<uint64_t> string_offsets;  // начало строки в string_data
+    std::vector<uint32_t> string_lengths;  // длина строки
+    std::string string_data;               // общий буфер символов
+
+    std::shared_ptr<const storage::MappedFile> mapping; // Файл, в который указывают view, если столбец отображён
+    const uint64_t* null_view = nullptr;
+    const int32_t* int_view = nullptr;
+    const uint64_t* bool_view = nullptr;
+    const uint64_t* offset_view = nullptr;
+    const uint32_t* length_view = nullptr;
+    const char* char_view = nullptr;
+    size_t char_count = 0;
+
+    void refresh_views();
+    [[noreturn]] static void throw_out_of_bounds();
+    void prepare_write() { if (mapping) materialize(); }
+    void push_null_bit(bool is_null_value);
+    void set_null_bit(size_t row, bool is_null_value);
+    void set_bool_bit(size_t row, bool value);
+};
+
+#endif // COLUMN_H
@@ -0,0 +1,177 @@
+#include "condition.h"
+#include "lexer.h"
+#include <charconv>
+#include <stdexcept>
+
+Condition::Condition(bool value) {
+    Node node;
+    node.kind = NodeKind::Constant;
+    node.bool_value = value;
+    root = add_node(std::move(node));
+    source = value ? "true" : "false";
+}
+
+size_t Condition::add_node(Node node) {
+    nodes.push_back(std::move(node));
+    return nodes.size() - 1;
+}
+
+Condition Condition::parse(std::string_view text) {
+    Lexer lexer(text);
+    size_t parameter_count = 0;
+    Condition condition = parse(lexer, parameter_count);
+    if (parameter_count > 0) {
+        throw std::runtime_error("Parameters are only allowed in prepared statements: " + std::string(text));
+    }
+    return condition;
+}
+
+Condition Condition::parse(Lexer& lexer, size_t& parameter_count) {
+    Condition condition;
+    condition.nodes.clear();
+    size_t start = lexer.peek().position;
+    condition.root = condition.parse_or(lexer, parameter_count);
+    if (lexer.peek().kind != Token::Kind::End) {
+        lexer.fail("Unexpected token after condition");
+    }
+
+    // Текст условия без пробелов по краям
+    std::string_view text = lexer.source().substr(start);
+    while (!text.empty() && (text.back() == ' ' || text.back() == '\t' || text.back() == '\n' || text.back() == '\r')) {
+        text.remove_suffix(1);
+    }
+    condition.source = std::string(text);
+    return condition;
+}
+
+// или := и { OR и }
+size_t Condition::parse_or(Lexer& lexer, size_t& parameter_count) {
+    size_t left = parse_and(lexer, parameter_count);
+    while (lexer.accept_word("OR")) {
+        Node node;
+        node.kind = NodeKind::Or;
+        node.left = left;
+        node.right = parse_and(lexer, parameter_count);
+        left = add_node(std::move(node));
+    }
+    return left;
+}
+
+// и := первичное { AND первичное }
+size_t Condition::parse_and(Lexer& lexer, size_t& parameter_count) {
+    size_t left = parse_primary(lexer, parameter_count);
+    while (lexer.accept_word("AND")) {
+        Node node;
+        node.kind = NodeKind::And;
+        node.left = left;
+        node.right = parse_primary(lexer, parameter_count);
+        left = add_node(std::move(node));
+    }
+    return left;
+}
+
+// первичное := ( или ) | true | false | столбец <op> значение
+size_t Condition::parse_primary(Lexer& lexer, size_t& parameter_count) {
+    if (lexer.accept(Token::Kind::LeftParen)) {
+        size_t inner = parse_or(lexer, parameter_count);
+        lexer.expect(Token::Kind::RightParen, "Expected ')' in condition");
+        return inner;
+    }
+
+    Token column = lexer.expect(Token::Kind::Word, "Expected column name in condition");
+    if (column.text == "true" || column.text == "false") {
+        Node node;
+        node.kind = NodeKind::Constant;
+        node.bool_value = (column.text == "true");
+        return add_node(std::move(node));
+    }
+
+    Node node;
+    node.kind = NodeKind::Compare;
+    node.column = std::string(column.text);
+    Token op = lexer.next();
+    switch (op.kind) {
+    case Token::Kind::Equal: node.op = CompareOp::Eq; break;
+    case Token::Kind::Less: node.op = CompareOp::Lt; break;
+    case Token::Kind::LessEqual: node.op = CompareOp::Le; break;
+    case Token::Kind::Greater: node.op = CompareOp::Gt; break;
+    case Token::Kind::GreaterEqual: node.op = CompareOp::Ge; break;
+    default:
+        throw std::runtime_error("Invalid condition format: expected comparison operator after '" + node.column + "'.");
+    }
+
+    const Token& value = lexer.peek();
+    switch (value.kind) {
+    case Token::Kind::Number:
+        node.value_kind = ValueKind::Int;
+        node.int_value = parse_int32(value.text);
+        break;
+    case Token::Kind::String:
+        node.value_kind = ValueKind::String;
+        node.string_value = std::string(value.text);
+        break;
+    case Token::Kind::Question:
+        node.value_kind = ValueKind::Parameter;
+        node.parameter = parameter_count++;
+        break;
+    case Token::Kind::Word:
+        if (value.text == "true" || value.text == "false") {
+            node.value_kind = ValueKind::Bool;
+            node.bool_value = (value.text == "true");
+            break;
+        }
+        if (value.text == "NULL" || value.text == "null") {
+            node.value_kind = ValueKind::Null;
+            break;
+        }
+        [[fallthrough]];
+    default:
+        lexer.fail("Unsupported value format in condition");
+    }
+    lexer.next();
+    return add_node(std::move(node));
+}
+
+Condition Condition::bind(const std::vector<std::any>& parameters) const {
+    Condition bound = *this;
+    for (Node& node : bound.nodes) {
+        if (node.kind != NodeKind::Compare || node.value_kind != ValueKind::Parameter) {
+            continue;
+        }
+        if (node.parameter >= parameters.size()) {
+            throw std::runtime_error("Parameter " + std::to_string(node.parameter + 1) + " is not bound.");
+        }
+        const std::any& value = parameters[node.parameter];
+        if (!value.has_value()) {
+            node.value_kind = ValueKind::Null;
+        }
+        else if (value.type() == typeid(int)) {
+            node.value_kind = ValueKind::Int;
+            node.int_value = std::any_cast<int>(value);
+        }
+        else if (value.type() == typeid(bool)) {
+            node.value_kind = ValueKind::Bool;
+            node.bool_value = std::any_cast<bool>(value);
+        }
+        else if (value.type() == typeid(std::string)) {
+            node.value_kind = ValueKind::String;
+            node.string_value = std::any_cast<const std::string&>(value);
+        }
+        else {
+            throw std::runtime_error("Unsupported parameter type: " + std::string(value.type().name()));
+        }
+    }
+    return bound;
+}
+
+int32_t parse_int32(std::string_view text) {
+    if (!text.empty() && text.front() == '+') {
+        text.remove_prefix(1);
+    }
+    int32_t value = 0;
+    auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (error != std::errc() || end != text.data() + text.size()) {
+        throw std::runtime_error("Invalid integer value: " + std::string(text));
+    }
+    return value;
+}
@@ -0,0 +1,89 @@
+#pragma once
+#ifndef CONDITION_H
+#define CONDITION_H
+
+#include <any>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class Lexer;
+
+/**
+ * @brief Оператор сравнения в условии.
+ */
+enum class CompareOp {
+    Eq,
+    Lt,
+    Le,
+    Gt,
+    Ge
+};
+
+/**
+ * @class Condition
+ * Условие WHERE после разбора: дерево сравнений "столбец <op> значение", AND, OR, скобок и констант true / false.
+ * AND связывает сильнее OR. Столбцы ещё не привязаны к таблице - это делает Predicate::compile.
+ * Значением сравнения может быть параметр "?" подготовленного запроса; его подставляет bind.
+ */
+class Condition {
+public:
+    enum class NodeKind {
+        Constant, ///< true / false
+        Compare,  ///< столбец <op> значение
+        And,
+        Or
+    };
+
+    enum class ValueKind {
+        Int,
+        String,
+        Bool,
+        Null,
+        Parameter
+    };
+
+    struct Node {
+        NodeKind kind = NodeKind::Constant;
+        CompareOp op = CompareOp::Eq;
+        std::string column;
+        ValueKind value_kind = ValueKind::Null;
+        int32_t int_value = 0;
+        bool bool_value = false;        ///< Также значение узла Constant.
+        std::string string_value;
+        size_t parameter = 0;           ///< Номер параметра запроса (с нуля).
+        size_t left = 0;                ///< Дочерние узлы And / Or.
+        size_t right = 0;
+    };
+
+    Condition() : Condition(true) {}
+    explicit Condition(bool value); // Условие-константа
+
+    // Разбирает текст условия целиком.
+    static Condition parse(std::string_view text);
+    // Разбирает условие с текущей лексемы до конца запроса; parameter_count - счётчик параметров запроса.
+    static Condition parse(Lexer& lexer, size_t& parameter_count);
+
+    // Копия с подставленными значениями параметров (пустой std::any - NULL).
+    Condition bind(const std::vector<std::any>& parameters) const;
+
+    const std::vector<Node>& get_nodes() const { return nodes; }
+    size_t get_root() const { return root; }
+    const std::string& text() const { return source; } // Исходный текст (для сообщений)
+
+private:
+    std::vector<Node> nodes;
+    size_t root = 0;
+    std::string source;
+
+    size_t add_node(Node node);
+    size_t parse_or(Lexer& lexer, size_t& parameter_count);
+    size_t parse_and(Lexer& lexer, size_t& parameter_count);
+    size_t parse_primary(Lexer& lexer, size_t& parameter_count);
+};
+
+// Целое со знаком из текста лексемы; выход за int32 - ошибка.
+int32_t parse_int32(std::string_view text);
+
+#endif // CONDITION_H
@@ -0,0 +1,46 @@
+#include "cursor.h"
+#include "table.h"
+#include <algorithm>
+
+Cursor::Cursor(const Table& table, Predicate predicate, const Transaction* txn)
+    : table(&table), predicate(std::move(predicate)), txn(txn) {
+    // Условие по индексу сразу даёт готовый список строк
+    scanning = !table.find_indexed_rows(this->predicate, txn, batch);
+}
+
+bool Cursor::next() {
+    if (position < batch.size()) {
+        ++position;
+        return true;
+    }
+    if (!scanning) {
+        return false;
+    }
+
+    // Следующая порция, в которой есть подходящие строки; порции проверяются в этом потоке
+    while (next_row < table->row_count) {
+        size_t end = std::min(table->row_count, next_row + Table::kMorselRows);
+        batch = predicate.select(table->data, next_row, end);
+        table->drop_invisible(batch, txn);
+        next_row = end;
+        if (!batch.empty()) {
+            position = 1;
+            return true;
+        }
+    }
+    batch.clear();
+    position = 0;
+    return false;
+}
+
+RowView Cursor::row() const {
+    return RowView(table->data, table->columns, batch[position - 1]);
+}
+
+const std::vector<std::string>& Cursor::column_names() const {
+    return table->columns;
+}
+
+size_t Cursor::column_index(const std::string& name) const {
+    return table->get_column_index(name);
+}
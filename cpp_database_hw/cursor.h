@@ -0,0 +1,90 @@
+#pragma once
+#ifndef CURSOR_H
+#define CURSOR_H
+
+#include <any>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "column.h"
+#include "predicate.h"
+
+class Table;
+class Transaction;
+
+/**
+ * @class RowView
+ * Строка результата без копирования значений: номер строки и ссылки на хранилище таблицы.
+ * Столбцы задаются номером в порядке Table::column_names.
+ * Действительна, пока открыт выдавший её курсор.
+ */
+class RowView {
+public:
+    RowView(const std::vector<Column>& columns, const std::vector<std::string>& names, size_t row)
+        : columns(&columns), names(&names), row(row) {}
+
+    size_t column_count() const { return columns->size(); }
+    const std::string& column_name(size_t column) const { return (*names)[column]; }
+    ColumnType column_type(size_t column) const { return (*columns)[column].type(); }
+    size_t row_index() const { return row; } // Позиция строки в таблице
+
+    bool is_null(size_t column) const { return (*columns)[column].is_null(row); }
+    int32_t get_int(size_t column) const { return (*columns)[column].get_int(row); }
+    std::string_view get_string(size_t column) const { return (*columns)[column].get_string(row); }
+    bool get_bool(size_t column) const { return (*columns)[column].get_bool(row); }
+    std::any get(size_t column) const { return (*columns)[column].get(row); } // Копия (пустой std::any - NULL)
+
+private:
+    const std::vector<Column>* columns;
+    const std::vector<std::string>* names;
+    size_t row;
+};
+
+/**
+ * @class Cursor
+ * Потоковый проход по строкам, удовлетворяющим условию (Table::scan, Database::query).
+ * Полный проход проверяет таблицу порциями по Table::kMorselRows позиций, поэтому память
+ * не зависит от размера результата, а остановленный проход не проверяет оставшиеся строки.
+ * Номера строк, найденные по индексу, индекс выдаёт сразу.
+ *
+ *     Cursor cursor = table.scan(condition);
+ *     while (cursor.next()) {
+ *         RowView row = cursor.row();
+ *     }
+ *
+ * Таблица не должна меняться, пока курсор открыт: курсор Table::scan полагается на блокировку
+ * вызывающего, курсор Database::query держит блокировку чтения таблицы сам.
+ */
+class Cursor {
+public:
+    Cursor(Cursor&&) noexcept = default; // Без присваивания: блокировка должна сниматься раньше освобождения таблицы
+
+    // Переход к следующей строке; false - строк больше нет.
+    bool next();
+    RowView row() const;
+    const std::vector<std::string>& column_names() const;
+    size_t column_index(const std::string& name) const; // Номер столбца для RowView
+
+private:
+    friend class Table;
+    friend class Database;
+    Cursor(const Table& table, Predicate predicate, const Transaction* txn);
+
+    const Table* table;
+    Predicate predicate;
+    const Transaction* txn;
+    bool scanning = true;      // Полный проход; иначе batch - все строки, найденные по индексу
+    size_t next_row = 0;       // Начало следующей порции полного прохода
+    std::vector<size_t> batch; // Строки текущей порции
+    size_t position = 0;       // Номер текущей строки в batch плюс один (0 - до первой строки)
+
+    // Таблица и блокировка чтения курсора Database::query (блокировка снимается первой)
+    std::shared_ptr<const Table> owner;
+    std::shared_lock<std::shared_mutex> lock;
+};
+
+#endif // CURSOR_H
@@ -4,77 +4,1110 @@
 #include <stdexcept>
 #include <sstream>
 #include <iostream>
+#include <limits>
+#include <cstring>
+#include <filesystem>
+#include <algorithm>
+#include "thread_pool.h"
 
-void Database::create_table(const std::string& name, const std::map<std::string, std::string>& schema) {
-    if (tables.find(name) != tables.end()) {
-        throw std::runtime_error("Table already exists: " + name);
+namespace {
+
+// Длина цепочки дописанных изменений таблицы, после которой контрольная точка переписывает файл
+constexpr size_t kMaxDeltaChain = 16;
+
+// Запись журнала WAL - одна зафиксированная транзакция: u64 время фиксации, u32 число изменений, изменения.
+// Изменение начинается с u32 вида.
+enum class RedoKind : uint32_t {
+    CreateTable = 1,        ///< имя, u32 число столбцов, (имя столбца, тип)
+    CreateIndex = 2,        ///< таблица, столбец
+    CreateOrderedIndex = 3, ///< таблица, столбец
+    Insert = 4,             ///< таблица, u64 позиция строки, значения (Table::write_row)
+    Delete = 5,             ///< таблица, u64 позиция строки
+    CreateConstrainedTable = 6 ///< как CreateTable, затем u32 число ограничений, (столбец, ограничение)
+};
+
+std::string wal_name(const std::string& filename) {
+    return filename + ".wal";
+}
+
+} // namespace
+
+// Каталог: время фиксации, u64 число таблиц, для каждой имя, положение блоков (u64 смещение, u64 размер),
+// u32 число дописанных изменений и их положения
+std::string Database::encode_directory(const std::map<std::string, TableLocation>& locations, Timestamp checkpoint) {
+    storage::ByteBuffer directory;
+    directory.put_u64(checkpoint);
+    directory.put_u64(locations.size());
+    for (const auto& [name, location] : locations) {
+        directory.put_string(name);
+        directory.put_u64(location.offset);
+        directory.put_u64(location.size);
+        directory.put_u32(static_cast<uint32_t>(location.deltas.size()));
+        for (const auto& delta : location.deltas) {
+            directory.put_u64(delta.offset);
+            directory.put_u64(delta.size);
+        }
+    }
+    return directory.bytes();
+}
+
+void Database::create_table(const std::string& name, const std::map<std::string, std::string>& schema,
+    const std::map<std::string, std::string>& constraints) {
+    auto table = std::make_shared<Table>(schema);
+    for (const auto& [column, constraint] : constraints) {
+        table->add_constraint(column, constraint);
+    }
+    {
+        std::lock_guard<std::mutex> lock(catalog_mutex);
+        auto current = tables();
+        if (current->find(name) != current->end() || unloaded_tables.find(name) != unloaded_tables.end()) {
+            throw std::runtime_error("Table already exists: " + name);
+        }
+        Catalog updated = *current;
+        updated[name] = table;
+        publish(std::move(updated));
+    }
+    Transaction* txn = current_transaction();
+    if (txn) {
+        txn->record_action([this, name]() {
+            std::lock_guard<std::mutex> lock(catalog_mutex);
+            Catalog updated = *tables();
+            updated.erase(name);
+            publish(std::move(updated));
+        });
+
+        storage::ByteBuffer redo;
+        // Таблица без ограничений пишется прежним видом записи
+        redo.put_u32(static_cast<uint32_t>(constraints.empty() ? RedoKind::CreateTable : RedoKind::CreateConstrainedTable));
+        redo.put_string(name);
+        redo.put_u32(static_cast<uint32_t>(schema.size()));
+        for (const auto& [column, type] : schema) {
+            redo.put_string(column);
+            redo.put_string(type);
+        }
+        if (!constraints.empty()) {
+            redo.put_u32(static_cast<uint32_t>(constraints.size()));
+            for (const auto& [column, constraint] : constraints) {
+                redo.put_string(column);
+                redo.put_string(constraint);
+            }
+        }
+        txn->record_redo(redo.bytes());
+    }
+}
+
+void Database::create_index(const std::string& table_name, const std::string& column, bool ordered) {
+    std::unique_lock<std::shared_mutex> lock;
+    Table* table = get_table(table_name, lock);
+    if (!table) throw std::runtime_error("Table not found: " + table_name);
+
+    Transaction* txn = current_transaction();
+    if (ordered) {
+        table->create_ordered_index(column, txn);
+    }
+    else {
+        table->create_index(column, txn);
+    }
+    if (txn) {
+        storage::ByteBuffer redo;
+        redo.put_u32(static_cast<uint32_t>(ordered ? RedoKind::CreateOrderedIndex : RedoKind::CreateIndex));
+        redo.put_string(table_name);
+        redo.put_string(column);
+        txn->record_redo(redo.bytes());
+    }
+}
+
+// Поиск по опубликованному каталогу без блокировок; ещё не прочитанная таблица загружается под catalog_mutex
+std::shared_ptr<Table> Database::find_table(const std::string& name) {
+    auto current = tables();
+    auto it = current->find(name);
+    if (it != current->end()) {
+        return it->second;
     }
-    tables[name] = std::make_shared<Table>(schema);
+
+    std::lock_guard<std::mutex> lock(catalog_mutex);
+    current = tables(); // Таблицу мог загрузить другой поток
+    it = current->find(name);
+    if (it != current->end()) {
+        return it->second;
+    }
+    auto pending = unloaded_tables.find(name);
+    if (pending == unloaded_tables.end()) {
+        return nullptr;
+    }
+
+    // Первое обращение: таблица читается из исходного файла
+    auto table = read_table(pending->second);
+    unloaded_tables.erase(pending);
+    Catalog updated = *current;
+    updated[name] = table;
+    publish(std::move(updated));
+    return table;
 }
 
 Table* Database::get_table(const std::string& name) {
-    if (tables.find(name) == tables.end()) {
+    auto table = find_table(name);
+    if (table) {
+        auto checkpoint = std::atomic_load(&pending_checkpoint);
+        if (checkpoint) {
+            checkpoint->hand_over(table.get()); // Контрольная точка пишет прежнюю копию
+        }
+    }
+    return table.get();
+}
+
+const Table* Database::get_table_for_read(const std::string& name) {
+    return find_table(name).get();
+}
+
+Table* Database::get_table(const std::string& name, std::unique_lock<std::shared_mutex>& lock) {
+    auto table = find_table(name);
+    if (!table) {
         return nullptr;
     }
-    return tables[name].get();
+    lock = std::unique_lock<std::shared_mutex>(table->mutex());
+    auto checkpoint = std::atomic_load(&pending_checkpoint);
+    if (checkpoint) {
+        checkpoint->hand_over(table.get());
+    }
+    Transaction* txn = current_transaction();
+    if (txn) {
+        txn->use_table(table);
+    }
+    return table.get();
+}
+
+const Table* Database::get_table_for_read(const std::string& name, std::shared_lock<std::shared_mutex>& lock) {
+    auto table = find_table(name);
+    if (table) {
+        lock = std::shared_lock<std::shared_mutex>(table->mutex());
+    }
+    return table.get();
 }
 
 std::string Database::execute(const std::string& query) {
-    QueryProcessor processor;
-    return processor.parse_and_execute(*this, query);
+    return execute(QueryProcessor::parse(query), {});
+}
+
+PreparedStatement Database::prepare(const std::string& query) {
+    return PreparedStatement(*this, std::make_shared<const QueryProcessor::Statement>(QueryProcessor::parse(query)));
+}
+
+Cursor Database::query(const std::string& select_query) {
+    QueryProcessor::Statement statement = QueryProcessor::parse(select_query);
+    if (statement.kind != QueryProcessor::Statement::Kind::Select) {
+        throw std::runtime_error("Only SELECT without JOIN can be opened as a cursor: " + select_query);
+    }
+    auto table = find_table(statement.table);
+    if (!table) throw std::runtime_error("Table not found: " + statement.table);
+
+    std::shared_lock<std::shared_mutex> lock(table->mutex());
+    Cursor cursor = table->scan(statement.condition, current_transaction());
+    cursor.owner = table;
+    cursor.lock = std::move(lock);
+    return cursor;
+}
+
+std::string Database::execute(const QueryProcessor::Statement& statement, const std::vector<std::any>& parameters) {
+    if (QueryProcessor::is_transaction_control(statement)) {
+        return QueryProcessor::execute(*this, statement, parameters);
+    }
+    Transaction* txn = current_transaction();
+    if (txn) {
+        // Запрос внутри транзакции выполняется целиком или не выполняется
+        size_t mark = txn->mark();
+        try {
+            return QueryProcessor::execute(*this, statement, parameters);
+        }
+        catch (...) {
+            rollback(*txn, mark);
+            throw;
+        }
+    }
+
+    // Вне транзакции каждый запрос фиксируется сам
+    start_transaction();
+    std::string result;
+    try {
+        result = QueryProcessor::execute(*this, statement, parameters);
+    }
+    catch (...) {
+        finish_transaction(false);
+        throw;
+    }
+    finish_transaction(true);
+    maybe_checkpoint();
+    return result;
+}
+
+std::future<std::string> Database::execute_async(std::string query) {
+    if (QueryProcessor::is_transaction_control(query)) {
+        throw std::runtime_error("Transaction control is not supported in asynchronous queries: " + query);
+    }
+    std::call_once(executor_started, [this]() {
+        executor = std::make_unique<ThreadPool>(std::max(kMinQueryThreads, std::thread::hardware_concurrency()));
+    });
+    return executor->submit([this, query = std::move(query)]() { return execute(query); });
+}
+
+void Database::save_to_file(const std::string& filename) {
+    std::lock_guard<std::mutex> lock(checkpoint_mutex);
+    if (pending_checkpoint) {
+        finish_checkpoint();
+    }
+    start_checkpoint(filename, true);
+    finish_checkpoint();
 }
 
-void Database::save_to_file(const std::string& filename) const {
-    std::ofstream file(filename, std::ios::binary);
+void Database::set_checkpoint_policy(const CheckpointPolicy& policy) {
+    std::lock_guard<std::mutex> lock(checkpoint_mutex);
+    checkpoint_policy = policy;
+}
+
+void Database::checkpoint(bool full) {
+    if (current_transaction()) {
+        throw std::runtime_error("Cannot start a checkpoint while a transaction is active.");
+    }
+    std::lock_guard<std::mutex> lock(checkpoint_mutex);
+    if (database_file.empty()) {
+        throw std::runtime_error("Checkpoint requires a database file: use save_to_file first.");
+    }
+    if (!pending_checkpoint) {
+        start_checkpoint(database_file, full);
+    }
+}
+
+// Снимок: таблицы разделяются с контрольной точкой, пока их не изменит запрос (тогда она получает копию).
+// Вызывается под checkpoint_mutex.
+void Database::start_checkpoint(const std::string& filename, bool full) {
+    auto checkpoint = std::make_shared<Checkpoint>();
+    checkpoint->filename = filename;
+    checkpoint->temp_filename = filename + ".tmp";
+
+    // Дописывать можно только в действующий файл, где уже лежат все незагруженные таблицы
+    bool incremental = !full && checkpoint_policy.incremental && filename == database_file && !compaction_due();
+
+    // Ни одна фиксация не выполняется: снимок совпадает с last_commit и концом журнала
+    std::unique_lock<std::mutex> commits = drain_commits();
+    checkpoint->timestamp = last_commit;
+    checkpoint->wal_position = wal ? wal->size() : 0;
+    {
+        std::lock_guard<std::mutex> lock(catalog_mutex);
+        for (const auto& [name, table] : *tables()) {
+            checkpoint->tables.push_back(Checkpoint::Entry{ name, table, nullptr, false, {} });
+        }
+        checkpoint->unloaded.assign(unloaded_tables.begin(), unloaded_tables.end());
+        checkpoint->source_file = source_file;
+        checkpoint->source_mapping = source_mapping;
+    }
+    for (const auto& [name, location] : checkpoint->unloaded) {
+        incremental = incremental && file_directory.count(name) > 0;
+    }
+#ifdef _WIN32
+    incremental = incremental && !checkpoint->source_mapping; // Отображённый файл в Windows открыт только для чтения
+#endif
+    checkpoint->incremental = incremental;
+    if (incremental) {
+        checkpoint->previous = file_directory;
+    }
+
+    Checkpoint* state = checkpoint.get();
+    checkpoint->done = ThreadPool::shared().submit([state]() {
+        if (state->incremental) {
+            append_checkpoint(*state);
+        }
+        else {
+            write_checkpoint(*state);
+        }
+    });
+    std::atomic_store(&pending_checkpoint, checkpoint);
+}
+
+// Вызывается запросом, который держит блокировку записи таблицы, перед её изменением
+void Database::Checkpoint::hand_over(Table* table) {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto& entry : tables) {
+        if (entry.table.get() == table) {
+            // Начатую запись фоновый поток ведёт под блокировкой чтения, поэтому сюда попадаем уже после неё
+            if (!entry.started && !entry.copy) {
+                entry.copy = table->clone();
+            }
+            return;
+        }
+    }
+}
+
+// Выполняется в фоновом потоке: таблица пишется под блокировкой чтения (дожидаясь запроса,
+// который её меняет) или, если запрос успел передать копию, пишется копия
+void Database::write_snapshot_table(Checkpoint& checkpoint, Checkpoint::Entry& entry,
+    const std::function<void(const Table&)>& write) {
+    std::shared_lock<std::shared_mutex> lock(entry.table->mutex());
+    std::shared_ptr<const Table> source;
+    {
+        std::lock_guard<std::mutex> guard(checkpoint.mutex);
+        entry.started = true;
+        source = entry.copy ? entry.copy : entry.table;
+    }
+    if (source != entry.table) {
+        lock.unlock();
+    }
+    entry.mark = source->save_mark();
+    write(*source);
+}
+
+// Дописанные изменения и прежние каталоги остаются в файле мёртвым грузом: при его росте
+// или длинной цепочке изменений таблицы (каждое звено - отдельное чтение при загрузке) файл переписывается
+bool Database::compaction_due() const {
+    std::error_code error;
+    uint64_t file_size = std::filesystem::file_size(database_file, error);
+    if (error) {
+        return true;
+    }
+    uint64_t used = storage::kHeaderSize;
+    for (const auto& [name, location] : file_directory) {
+        if (location.deltas.size() >= kMaxDeltaChain) {
+            return true;
+        }
+        used += location.size;
+        for (const auto& delta : location.deltas) {
+            used += delta.size;
+        }
+    }
+    uint64_t unused = file_size > used ? file_size - used : 0;
+    return static_cast<double>(unused) > static_cast<double>(used) * checkpoint_policy.compact_ratio;
+}
+
+// Выполняется в фоновом потоке: читает только снимок
+void Database::write_checkpoint(Checkpoint& checkpoint) {
+    std::ofstream file(checkpoint.temp_filename, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        throw std::runtime_error("Failed to open file for saving: " + checkpoint.temp_filename);
+    }
+
+    storage::BinaryWriter out(file);
+    out.write_header();
+
+    for (auto& entry : checkpoint.tables) {
+        TableLocation& location = checkpoint.written[entry.name];
+        location.offset = out.position();
+        write_snapshot_table(checkpoint, entry, [&](const Table& table) { table.save(out); });
+        location.size = out.position() - location.offset;
+    }
+
+    // Незагруженные таблицы не менялись: их блоки и дописанные изменения копируются из исходного файла как есть
+    std::ifstream source;
+    if (!checkpoint.unloaded.empty() && !checkpoint.source_mapping) {
+        source.open(checkpoint.source_file, std::ios::binary);
+        if (!source.is_open()) {
+            throw std::runtime_error("Failed to open file for loading: " + checkpoint.source_file);
+        }
+    }
+    std::vector<char> buffer;
+    auto copy_region = [&](const TableLocation& region) {
+        TableLocation copy;
+        copy.offset = out.position();
+        copy.size = region.size;
+        if (checkpoint.source_mapping) {
+            out.write_bytes(checkpoint.source_mapping->data() + region.offset, static_cast<size_t>(region.size));
+            return copy;
+        }
+        constexpr uint64_t kChunk = uint64_t(1) << 20;
+        buffer.resize(static_cast<size_t>(std::min(kChunk, region.size)));
+        source.seekg(static_cast<std::streamoff>(region.offset));
+        for (uint64_t copied = 0; copied < region.size;) {
+            size_t chunk = static_cast<size_t>(std::min(kChunk, region.size - copied));
+            source.read(buffer.data(), static_cast<std::streamsize>(chunk));
+            if (static_cast<size_t>(source.gcount()) != chunk) {
+                throw std::runtime_error("Unexpected end of database file.");
+            }
+            out.write_bytes(buffer.data(), chunk);
+            copied += chunk;
+        }
+        return copy;
+    };
+    for (const auto& [name, location] : checkpoint.unloaded) {
+        TableLocation copy = copy_region(location);
+        for (const auto& delta : location.deltas) {
+            copy.deltas.push_back(copy_region(delta));
+        }
+        checkpoint.written[name] = std::move(copy);
+    }
+
+    uint64_t directory_position = out.position();
+    out.write_block(encode_directory(checkpoint.written, checkpoint.timestamp));
+    file.close();
+    if (!file) {
+        throw std::runtime_error("Failed to write database file: " + checkpoint.temp_filename);
+    }
+    storage::write_directory_position(checkpoint.temp_filename, directory_position);
+    storage::sync_file(checkpoint.temp_filename);
+}
+
+// Выполняется в фоновом потоке: дописывает в конец действующего файла изменения снимка и новый каталог.
+// Прежний каталог действует, пока заголовок не переключён, поэтому сбой во время записи оставляет файл верным.
+void Database::append_checkpoint(Checkpoint& checkpoint) {
+    std::fstream file(checkpoint.filename, std::ios::binary | std::ios::in | std::ios::out);
     if (!file.is_open()) {
-        throw std::runtime_error("Failed to open file for saving: " + filename);
+        throw std::runtime_error("Failed to open file for saving: " + checkpoint.filename);
+    }
+    file.seekp(0, std::ios::end);
+    storage::BinaryWriter out(file, static_cast<uint64_t>(file.tellp()));
+    out.align(); // Хвост оборванной записи мог оставить позицию невыровненной
+
+    for (auto& entry : checkpoint.tables) {
+        auto previous = checkpoint.previous.find(entry.name);
+        TableLocation& location = checkpoint.written[entry.name];
+        write_snapshot_table(checkpoint, entry, [&](const Table& table) {
+            if (previous == checkpoint.previous.end() || table.needs_full_save()) {
+                location.offset = out.position();
+                table.save(out);
+                location.size = out.position() - location.offset;
+                return;
+            }
+            location = previous->second;
+            if (table.has_unsaved_changes()) {
+                TableLocation delta;
+                delta.offset = out.position();
+                table.save_changes(out);
+                delta.size = out.position() - delta.offset;
+                location.deltas.push_back(delta);
+            }
+        });
+    }
+    for (const auto& [name, location] : checkpoint.unloaded) {
+        checkpoint.written[name] = checkpoint.previous.at(name);
     }
 
-    file << tables.size() << "\n";
-    for (const auto& [name, table] : tables) {
-        file << name << "\n";
-        table->save(file);
+    uint64_t directory_position = out.position();
+    out.write_block(encode_directory(checkpoint.written, checkpoint.timestamp));
+    file.close();
+    if (!file) {
+        throw std::runtime_error("Failed to write database file: " + checkpoint.filename);
+    }
+    // Заголовок переключается на новый каталог, только когда всё дописанное уже на диске
+    storage::sync_file(checkpoint.filename);
+    storage::write_directory_position(checkpoint.filename, directory_position);
+    storage::sync_file(checkpoint.filename);
+}
+
+// Замена файла, новые смещения таблиц и сокращение журнала. Вызывается под checkpoint_mutex.
+void Database::finish_checkpoint() {
+    std::shared_ptr<Checkpoint> checkpoint = pending_checkpoint;
+    try {
+        checkpoint->done.get();
+    }
+    catch (...) {
+        std::atomic_store(&pending_checkpoint, std::shared_ptr<Checkpoint>());
+        if (!checkpoint->incremental) {
+            std::error_code error;
+            std::filesystem::remove(checkpoint->temp_filename, error);
+        }
+        throw;
+    }
+    std::atomic_store(&pending_checkpoint, std::shared_ptr<Checkpoint>());
+
+    // Записанное состояние таблиц: следующая инкрементальная точка пишет только более новые изменения
+    for (const auto& entry : checkpoint->tables) {
+        std::unique_lock<std::shared_mutex> lock(entry.table->mutex());
+        entry.table->mark_persisted(entry.mark);
+    }
+    checkpoint->tables.clear();
+    checkpoint->source_mapping.reset();
+
+    // Дописанные изменения не сдвигают незагруженные таблицы; новый файл заменяет прежний
+    if (!checkpoint->incremental) {
+        std::error_code error;
+        bool replaces_source = !source_file.empty() && std::filesystem::equivalent(checkpoint->filename, source_file, error);
+#ifdef _WIN32
+        // Windows не заменяет отображённый файл: столбцы переносятся в память
+        if (replaces_source && source_mapping) {
+            for (const auto& [name, table] : *tables()) {
+                std::unique_lock<std::shared_mutex> lock(table->mutex());
+                table->detach();
+            }
+        }
+#endif
+        std::lock_guard<std::mutex> lock(catalog_mutex);
+#ifdef _WIN32
+        if (replaces_source) {
+            source_mapping.reset();
+        }
+#endif
+        storage::replace_file(checkpoint->temp_filename, checkpoint->filename);
+
+        if (replaces_source) {
+            // Прежний файл заменён: ещё не загруженные таблицы читаются из нового.
+            // Уже отображённые столбцы держат старое отображение, пока живы.
+            for (auto& [name, location] : unloaded_tables) {
+                location = checkpoint->written.at(name);
+            }
+            if (source_mapping) {
+                source_mapping = std::make_shared<const storage::MappedFile>(checkpoint->filename);
+            }
+        }
+    }
+
+    // Фиксации, сделанные во время записи, переносятся в новый журнал файла
+    std::unique_lock<std::mutex> commits = drain_commits();
+    std::string tail = wal ? wal->read_tail(checkpoint->wal_position) : std::string();
+    wal.reset();
+    storage::WriteAheadLog::reset(wal_name(checkpoint->filename), tail);
+    wal = std::make_unique<storage::WriteAheadLog>(wal_name(checkpoint->filename));
+    database_file = checkpoint->filename;
+    file_directory = std::move(checkpoint->written);
+    last_checkpoint_time = std::chrono::steady_clock::now();
+}
+
+void Database::wait_for_checkpoint() {
+    std::lock_guard<std::mutex> lock(checkpoint_mutex);
+    if (pending_checkpoint) {
+        finish_checkpoint();
     }
 }
 
-void Database::load_from_file(const std::string& filename) {
+// Проверяется после запроса вне транзакции: завершает готовую контрольную точку или запускает новую
+void Database::maybe_checkpoint() {
+    // Контрольной точкой уже занят другой поток
+    std::unique_lock<std::mutex> lock(checkpoint_mutex, std::try_to_lock);
+    if (!lock) {
+        return;
+    }
+    if (pending_checkpoint) {
+        if (pending_checkpoint->done.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+            return;
+        }
+        try {
+            finish_checkpoint();
+        }
+        catch (const std::exception& e) {
+            // Запрос уже выполнен; прежний файл и журнал остаются верными
+            std::cerr << "Background checkpoint failed: " << e.what() << std::endl;
+        }
+        return;
+    }
+    if (!wal) {
+        return;
+    }
+    bool wal_full = checkpoint_policy.wal_bytes > 0 && wal->size() >= checkpoint_policy.wal_bytes;
+    bool interval_passed = checkpoint_policy.interval.count() > 0 &&
+        std::chrono::steady_clock::now() - last_checkpoint_time >= checkpoint_policy.interval;
+    if (wal_full || interval_passed) {
+        start_checkpoint(database_file, false);
+    }
+}
+
+Database::~Database() {
+    executor.reset(); // Дожидается запросов в очереди
+    try {
+        wait_for_checkpoint();
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Checkpoint failed: " << e.what() << std::endl;
+    }
+    delete catalog.load();
+}
+
+Database::CatalogView Database::tables() const {
+    EpochDomain::Guard guard = catalog_epochs.pin();
+    return CatalogView(std::move(guard), catalog.load());
+}
+
+void Database::publish(Catalog tables) {
+    const Catalog* previous = catalog.exchange(new Catalog(std::move(tables)));
+    catalog_epochs.retire(previous);
+}
+
+void Database::load_from_file(const std::string& filename, bool preload) {
+    ensure_no_transaction();
+    wait_for_checkpoint();
     std::ifstream file(filename, std::ios::binary);
     if (!file.is_open()) {
         throw std::runtime_error("Failed to open file for loading: " + filename);
     }
 
+    // Файлы прежних версий - текстовые, без заголовка формата
+    char magic[sizeof(storage::kMagic)] = {};
+    file.read(magic, sizeof(magic));
+    bool binary = file.gcount() == sizeof(magic) && std::memcmp(magic, storage::kMagic, sizeof(magic)) == 0;
+    file.clear();
+    file.seekg(0);
+    if (!binary) {
+        load_text(file);
+        return;
+    }
+
+    file.seekg(0, std::ios::end);
+    uint64_t file_size = static_cast<uint64_t>(file.tellg());
+    file.seekg(0);
+    storage::BinaryReader in(file);
+    uint64_t directory_position = in.read_header();
+    if (directory_position < storage::kHeaderSize || directory_position >= file_size) {
+        throw std::runtime_error("Corrupted table directory in database file.");
+    }
+    in.seek(directory_position);
+    last_commit = read_directory(in.read_block(), file_size);
+
+    source_file = filename;
+    source_mapping.reset();
+    open_wal(filename);
+    if (preload) {
+        load_all_tables();
+    }
+}
+
+void Database::open_mapped(const std::string& filename) {
+    ensure_no_transaction();
+    wait_for_checkpoint();
+    auto file = std::make_shared<const storage::MappedFile>(filename);
+    storage::MemoryReader in(file->data(), file->size());
+    in.seek(in.read_header());
+    last_commit = read_directory(in.read_block(), file->size());
+
+    source_file = filename;
+    source_mapping = file;
+    open_wal(filename);
+}
+
+// Блоки таблицы или изменений должны занимать ровно записанную в каталоге область
+void Database::check_region_end(const TableLocation& region, uint64_t end_position) {
+    if (end_position != region.offset + region.size) {
+        throw std::runtime_error("Corrupted table directory in database file.");
+    }
+}
+
+// Возвращает время последней фиксации, попавшей в файл
+Timestamp Database::read_directory(std::string_view directory, uint64_t file_size) {
+    storage::ByteCursor cursor(directory);
+    Timestamp checkpoint = cursor.get_u64();
+    uint64_t table_count = cursor.get_u64();
+
+    auto read_region = [&]() {
+        TableLocation region;
+        region.offset = cursor.get_u64();
+        region.size = cursor.get_u64();
+        if (region.offset > file_size || region.size > file_size - region.offset) {
+            throw std::runtime_error("Corrupted table directory in database file.");
+        }
+        return region;
+    };
+    std::map<std::string, TableLocation> locations;
+    for (uint64_t i = 0; i < table_count; ++i) {
+        std::string name = cursor.get_string();
+        TableLocation location = read_region();
+        uint32_t delta_count = cursor.get_u32();
+        for (uint32_t j = 0; j < delta_count; ++j) {
+            location.deltas.push_back(read_region());
+        }
+        locations[name] = std::move(location);
+    }
+    publish(Catalog());
+    file_directory = locations;
+    unloaded_tables = std::move(locations);
+    return checkpoint;
+}
+
+// Связывает базу с журналом файла, сначала применяя записи журнала новее файла
+void Database::open_wal(const std::string& filename) {
+    wal.reset();
+    size_t replayed = 0;
+    for (const auto& record : storage::WriteAheadLog::read_records(wal_name(filename))) {
+        storage::ByteCursor in(record);
+        Timestamp commit_ts = in.get_u64();
+        if (commit_ts <= last_commit) {
+            continue; // Фиксация уже сохранена в файле базы
+        }
+        uint32_t count = in.get_u32();
+        for (uint32_t i = 0; i < count; ++i) {
+            replay_redo(in);
+        }
+        last_commit = commit_ts;
+        ++replayed;
+    }
+    if (replayed > 0) {
+        std::cout << "Replayed " << replayed << " transaction(s) from write-ahead log.\n";
+    }
+    next_commit = last_commit;
+    wal = std::make_unique<storage::WriteAheadLog>(wal_name(filename));
+    database_file = filename;
+    last_checkpoint_time = std::chrono::steady_clock::now();
+}
+
+void Database::replay_redo(storage::ByteCursor& in) {
+    RedoKind kind = static_cast<RedoKind>(in.get_u32());
+    if (kind == RedoKind::CreateTable || kind == RedoKind::CreateConstrainedTable) {
+        std::string name = in.get_string();
+        std::map<std::string, std::string> schema;
+        uint32_t column_count = in.get_u32();
+        for (uint32_t i = 0; i < column_count; ++i) {
+            std::string column = in.get_string();
+            schema[column] = in.get_string();
+        }
+        std::map<std::string, std::string> constraints;
+        if (kind == RedoKind::CreateConstrainedTable) {
+            uint32_t constraint_count = in.get_u32();
+            for (uint32_t i = 0; i < constraint_count; ++i) {
+                std::string column = in.get_string();
+                constraints[column] = in.get_string();
+            }
+        }
+        create_table(name, schema, constraints);
+        return;
+    }
+
+    std::string table_name = in.get_string();
+    Table* table = get_table(table_name);
+    if (!table) {
+        throw std::runtime_error("Corrupted write-ahead log: table not found: " + table_name);
+    }
+    switch (kind) {
+    case RedoKind::CreateIndex:
+        table->create_index(in.get_string());
+        break;
+    case RedoKind::CreateOrderedIndex:
+        table->create_ordered_index(in.get_string());
+        break;
+    case RedoKind::Insert: {
+        uint64_t row = in.get_u64();
+        table->redo_insert(static_cast<size_t>(row), in);
+        break;
+    }
+    case RedoKind::Delete:
+        table->redo_delete(static_cast<size_t>(in.get_u64()));
+        break;
+    default:
+        throw std::runtime_error("Corrupted write-ahead log: unknown record.");
+    }
+}
+
+std::shared_ptr<Table> Database::read_table(const TableLocation& location) const {
+    auto table = std::make_shared<Table>();
+    if (source_mapping) {
+        storage::MemoryReader in(source_mapping->data(), source_mapping->size());
+        in.seek(location.offset);
+        table->attach(in, source_mapping);
+        check_region_end(location, in.position());
+        for (const auto& delta : location.deltas) {
+            in.seek(delta.offset);
+            table->load_changes(in);
+            check_region_end(delta, in.position());
+        }
+        return table;
+    }
+
+    // Таблица читается одним блоком, разбор столбцов идёт параллельно из памяти
+    std::ifstream file(source_file, std::ios::binary);
+    if (!file.is_open()) {
+        throw std::runtime_error("Failed to open file for loading: " + source_file);
+    }
+    auto read_region = [&](const TableLocation& region) {
+        if (region.offset % 8 != 0) {
+            throw std::runtime_error("Corrupted table directory in database file.");
+        }
+        std::vector<uint64_t> buffer(static_cast<size_t>((region.size + 7) / 8));
+        file.seekg(static_cast<std::streamoff>(region.offset));
+        file.read(reinterpret_cast<char*>(buffer.data()), static_cast<std::streamsize>(region.size));
+        if (static_cast<uint64_t>(file.gcount()) != region.size) {
+            throw std::runtime_error("Unexpected end of database file.");
+        }
+        return buffer;
+    };
+    std::vector<uint64_t> buffer = read_region(location);
+    storage::MemoryReader in(reinterpret_cast<const char*>(buffer.data()), static_cast<size_t>(location.size));
+    table->load(in);
+    check_region_end(location, location.offset + in.position());
+    for (const auto& delta : location.deltas) {
+        std::vector<uint64_t> changes = read_region(delta);
+        storage::MemoryReader delta_in(reinterpret_cast<const char*>(changes.data()), static_cast<size_t>(delta.size));
+        table->load_changes(delta_in);
+        check_region_end(delta, delta.offset + delta_in.position());
+    }
+    return table;
+}
+
+void Database::load_all_tables() {
+    std::vector<std::pair<std::string, TableLocation>> pending(unloaded_tables.begin(), unloaded_tables.end());
+    std::vector<std::shared_ptr<Table>> loaded(pending.size());
+    ThreadPool::shared().parallel_for(pending.size(), [&](size_t i) {
+        loaded[i] = read_table(pending[i].second);
+    });
+
+    std::lock_guard<std::mutex> lock(catalog_mutex);
+    Catalog updated = *tables();
+    for (size_t i = 0; i < pending.size(); ++i) {
+        const std::string& name = pending[i].first;
+        unloaded_tables.erase(name);
+        updated[name] = loaded[i];
+    }
+    publish(std::move(updated));
+}
+
+void Database::load_text(std::istream& file) {
     size_t table_count;
     file >> table_count;
     file.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
 
-    tables.clear();
+    unloaded_tables.clear();
+    source_file.clear();
+    source_mapping.reset();
+    wal.reset(); // Текстовый файл не ведёт журнала до следующего save_to_file
+    database_file.clear();
+    file_directory.clear();
+    Catalog loaded;
     for (size_t i = 0; i < table_count; ++i) {
         std::string name;
         std::getline(file, name);
         auto table = std::make_shared<Table>();
-        table->load(file);
-        tables[name] = table;
+        table->load_text(file);
+        loaded[name] = table;
+    }
+    publish(std::move(loaded));
+}
+
+Transaction* Database::current_transaction() {
+    std::lock_guard<std::mutex> lock(transactions_mutex);
+    auto it = transactions.find(std::this_thread::get_id());
+    return it != transactions.end() ? it->second.get() : nullptr;
+}
+
+// Снимок берётся под transactions_mutex, чтобы oldest_active_read не пропустил начинающуюся транзакцию
+Transaction& Database::start_transaction() {
+    std::lock_guard<std::mutex> lock(transactions_mutex);
+    auto& slot = transactions[std::this_thread::get_id()];
+    slot = std::make_unique<Transaction>(next_transaction_id++, last_commit);
+    return *slot;
+}
+
+// Самый старый снимок, который ещё читают: более ранние версии можно освобождать
+Timestamp Database::oldest_active_read() {
+    std::lock_guard<std::mutex> lock(transactions_mutex);
+    Timestamp oldest = last_commit;
+    for (const auto& [thread, txn] : transactions) {
+        oldest = std::min(oldest, txn->read_timestamp());
     }
+    return oldest;
 }
 
 void Database::begin_transaction() {
-    transaction_stack.push_back(tables);
+    Transaction* txn = current_transaction();
+    if (txn) {
+        // Вложенная транзакция откатывается до позиции журнала, с которой началась
+        txn->begin_nested();
+    }
+    else {
+        start_transaction();
+    }
     std::cout << "Transaction started.\n";
 }
 
 void Database::rollback_transaction() {
-    if (transaction_stack.empty()) {
-        throw std::runtime_error("No active transaction to rollback.");
+    Transaction& txn = active_transaction("ROLLBACK");
+    if (txn.in_nested()) {
+        auto locks = lock_for_write(txn);
+        txn.rollback_nested();
+    }
+    else {
+        finish_transaction(false);
     }
-    tables = transaction_stack.back();
-    transaction_stack.pop_back();
     std::cout << "Transaction rolled back.\n";
 }
 
 void Database::commit_transaction() {
-    if (transaction_stack.empty()) {
-        throw std::runtime_error("No active transaction to commit.");
+    Transaction& txn = active_transaction("COMMIT");
+    if (txn.in_nested()) {
+        txn.commit_nested(); // Изменения переходят во внешнюю транзакцию
+    }
+    else {
+        finish_transaction(true);
     }
-    transaction_stack.pop_back();
     std::cout << "Transaction committed.\n";
 }
+
+void Database::savepoint(const std::string& name) {
+    active_transaction("SAVEPOINT").savepoint(name);
+}
+
+void Database::rollback_to_savepoint(const std::string& name) {
+    Transaction& txn = active_transaction("ROLLBACK TO");
+    auto locks = lock_for_write(txn);
+    txn.rollback_to_savepoint(name);
+}
+
+void Database::release_savepoint(const std::string& name) {
+    active_transaction("RELEASE").release_savepoint(name);
+}
+
+Transaction& Database::active_transaction(const std::string& command) {
+    Transaction* txn = current_transaction();
+    if (!txn) {
+        throw std::runtime_error(command + " can only be used inside a transaction.");
+    }
+    return *txn;
+}
+
+// Таблицы транзакции блокируются по возрастанию адреса - в одном порядке во всех потоках
+std::vector<Table*> Database::lock_order(const Transaction& txn) {
+    std::vector<Table*> used;
+    for (const auto& table : txn.tables()) {
+        used.push_back(table.get());
+    }
+    std::sort(used.begin(), used.end(), std::less<Table*>());
+    return used;
+}
+
+// Таблицу, которую ещё не записала контрольная точка, та получает копией до изменения
+std::vector<std::unique_lock<std::shared_mutex>> Database::lock_for_write(const Transaction& txn) {
+    auto checkpoint = std::atomic_load(&pending_checkpoint);
+    std::vector<std::unique_lock<std::shared_mutex>> locks;
+    for (Table* table : lock_order(txn)) {
+        locks.emplace_back(table->mutex());
+        if (checkpoint) {
+            checkpoint->hand_over(table);
+        }
+    }
+    return locks;
+}
+
+// Откат части транзакции (неудачный запрос)
+void Database::rollback(Transaction& txn, size_t mark) {
+    auto locks = lock_for_write(txn);
+    txn.rollback_to(mark);
+}
+
+std::unique_lock<std::mutex> Database::drain_commits() {
+    std::unique_lock<std::mutex> lock(commit_mutex);
+    commit_applied.wait(lock, [this]() { return last_commit == next_commit; });
+    return lock;
+}
+
+// Завершение транзакции потока: фиксация или откат целиком
+void Database::finish_transaction(bool commit) {
+    std::unique_ptr<Transaction> txn;
+    {
+        std::lock_guard<std::mutex> lock(transactions_mutex);
+        auto it = transactions.find(std::this_thread::get_id());
+        txn = std::move(it->second);
+        transactions.erase(it);
+    }
+
+    Timestamp commit_ts = 0;
+    storage::WriteAheadLog* log = nullptr;
+    uint64_t sequence = 0;
+    if (commit) {
+        try {
+            // Время фиксации и место записи в журнале выдаются в одном порядке
+            std::lock_guard<std::mutex> lock(commit_mutex);
+            if (wal) {
+                std::vector<std::shared_lock<std::shared_mutex>> locks;
+                for (Table* table : lock_order(*txn)) {
+                    locks.emplace_back(table->mutex());
+                }
+                std::string record = encode_commit(*txn, next_commit + 1);
+                if (!record.empty()) {
+                    sequence = wal->append(record);
+                    log = wal.get();
+                }
+            }
+            commit_ts = ++next_commit;
+        }
+        catch (...) {
+            apply_commit(*txn, 0, false);
+            throw;
+        }
+    }
+
+    // Фиксация считается выполненной, когда её запись на диске; записи других потоков уходят тем же fsync
+    std::exception_ptr failure;
+    if (log) {
+        try {
+            log->wait(sequence);
+        }
+        catch (...) {
+            failure = std::current_exception();
+        }
+    }
+    apply_commit(*txn, commit_ts, commit && !failure);
+    if (failure) {
+        std::rethrow_exception(failure);
+    }
+}
+
+// Фиксации применяются к таблицам по порядку времени: last_commit сдвигается, только когда все
+// более ранние фиксации видны. commit_ts = 0 - откат без выданного времени.
+void Database::apply_commit(Transaction& txn, Timestamp commit_ts, bool commit) {
+    if (commit_ts != 0) {
+        std::unique_lock<std::mutex> lock(commit_mutex);
+        commit_applied.wait(lock, [this, commit_ts]() { return last_commit == commit_ts - 1; });
+    }
+    {
+        auto locks = lock_for_write(txn);
+        if (commit) {
+            txn.commit(commit_ts);
+        }
+        else {
+            txn.rollback_to(0);
+        }
+
+        // Освобождаются версии, которые больше никто не видит
+        Timestamp oldest = oldest_active_read();
+        for (const auto& table : txn.tables()) {
+            table->collect_garbage(oldest);
+        }
+    }
+    if (commit_ts != 0) {
+        std::lock_guard<std::mutex> lock(commit_mutex);
+        last_commit = commit_ts;
+        commit_applied.notify_all();
+    }
+}
+
+// Запись журнала для транзакции; пустая строка, если транзакция ничего не изменила
+std::string Database::encode_commit(const Transaction& txn, Timestamp commit_ts) const {
+    const auto& changes = txn.changes();
+    uint32_t count = 0;
+    for (const auto& change : changes) {
+        if (change.kind != UndoKind::Action) {
+            ++count;
+        }
+    }
+    if (count == 0) {
+        return std::string();
+    }
+
+    std::map<const Table*, const std::string*> table_names;
+    auto current = tables();
+    for (const auto& [name, table] : *current) {
+        table_names[table.get()] = &name;
+    }
+
+    storage::ByteBuffer record;
+    record.put_u64(commit_ts);
+    record.put_u32(count);
+    for (const auto& change : changes) {
+        switch (change.kind) {
+        case UndoKind::Redo:
+            record.put_bytes(txn.redo_entry(change.row));
+            break;
+        case UndoKind::Inserted:
+            record.put_u32(static_cast<uint32_t>(RedoKind::Insert));
+            record.put_string(*table_names.at(change.table));
+            record.put_u64(change.row);
+            change.table->write_row(change.row, record);
+            break;
+        case UndoKind::Deleted:
+            record.put_u32(static_cast<uint32_t>(RedoKind::Delete));
+            record.put_string(*table_names.at(change.table));
+            record.put_u64(change.row);
+            break;
+        case UndoKind::Action:
+            break;
+        }
+    }
+    return record.bytes();
+}
+
+void Database::ensure_no_transaction() {
+    std::lock_guard<std::mutex> lock(transactions_mutex);
+    if (!transactions.empty()) {
+        throw std::runtime_error("Cannot replace the database while a transaction is active.");
+    }
+}
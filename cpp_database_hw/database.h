@@ -5,37 +5,250 @@
 #include <map>
 #include <memory>
 #include <vector>
+#include <chrono>
+#include <future>
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include <condition_variable>
+#include <thread>
+#include "epoch.h"
 #include "table.h"
+#include "thread_pool.h"
+#include "mapped_file.h"
+#include "prepared_statement.h"
+#include "query_processor.h"
+#include "write_ahead_log.h"
 
+/**
+ * @class Database
+ * execute можно вызывать из нескольких потоков одновременно. Транзакция принадлежит потоку,
+ * который её начал. Запрос блокирует свою таблицу: чтение - разделяемо, изменение - монопольно
+ * на время запроса; изоляцию транзакций между запросами обеспечивают версии строк (MVCC).
+ * Каталог таблиц публикуется неизменяемыми копиями через атомарный указатель, поэтому поиск таблицы
+ * не блокируется; прежние копии освобождаются, когда их больше не читают (EpochDomain).
+ * Загрузка базы (load_from_file, open_mapped) не должна выполняться одновременно с другими вызовами.
+ */
 class Database {
 public:
-    //       .
-    void create_table(const std::string& name, const std::map<std::string, std::string>& schema);
+    Database() = default;
+    ~Database(); // Дожидается запущенной контрольной точки
 
-    //       .
+    // Создаёт таблицу с указанным именем и схемой.
+    // constraints: столбец -> "PRIMARY KEY", "UNIQUE" или "NOT NULL" (см. Table)
+    void create_table(const std::string& name, const std::map<std::string, std::string>& schema,
+        const std::map<std::string, std::string>& constraints = {});
+
+    // Создаёт индекс по столбцу таблицы; ordered - упорядоченный индекс для диапазонных условий.
+    void create_index(const std::string& table_name, const std::string& column, bool ordered = false);
+
+    // Получает указатель на таблицу по её имени (без блокировки - для однопоточного использования).
     Table* get_table(const std::string& name);
 
-    //  SQL-      .
+    // Таблица только для чтения: во время контрольной точки её не нужно копировать.
+    const Table* get_table_for_read(const std::string& name);
+
+    // Таблица, заблокированная на время запроса: lock получает блокировку записи или чтения.
+    // Изменяемая таблица становится частью текущей транзакции потока.
+    Table* get_table(const std::string& name, std::unique_lock<std::shared_mutex>& lock);
+    const Table* get_table_for_read(const std::string& name, std::shared_lock<std::shared_mutex>& lock);
+
+    // Выполняет SQL-запрос и возвращает результат в виде строки.
+    // Вне транзакции запрос выполняется в собственной транзакции и сразу фиксируется.
     std::string execute(const std::string& query);
 
-    //      .
-    void save_to_file(const std::string& filename) const;
+    // Подготовленный запрос: текст разбирается один раз, значения параметров "?" задаются
+    // PreparedStatement::bind перед каждым выполнением. Пример: "INSERT TO users (id=?,name=?)".
+    PreparedStatement prepare(const std::string& query);
+    // Потоковое чтение SELECT ... FROM t [WHERE ...]: строки читаются курсором по одной, результат не собирается.
+    // Курсор держит блокировку чтения таблицы, пока существует, поэтому изменять эту таблицу из того же
+    // потока до закрытия курсора нельзя. В транзакции курсор видит её снимок и не должен её пережить;
+    // вне транзакции - последнее зафиксированное состояние.
+    Cursor query(const std::string& select_query);
+    // Выполняет разобранный запрос с значениями параметров (используется PreparedStatement).
+    std::string execute(const QueryProcessor::Statement& statement, const std::vector<std::any>& parameters);
+
+    // Асинхронный запрос: ставится в очередь потоков базы и возвращает управление сразу.
+    // Запрос выполняется в собственной транзакции и фиксируется (транзакцию вызывающего потока он не видит);
+    // результат или исключение передаются через future. Запросы очереди выполняются в порядке постановки,
+    // но одновременно на нескольких потоках. BEGIN / COMMIT и точки сохранения асинхронно не выполняются.
+    std::future<std::string> execute_async(std::string query);
+
+    // Сохраняет базу данных в бинарный файл (формат описан в storage_format.h) и ждёт окончания записи.
+    // Ещё не загруженные таблицы копируются из исходного файла без разбора.
+    // После сохранения зафиксированные изменения дописываются в журнал <filename>.wal.
+    void save_to_file(const std::string& filename);
 
-    //      .
-    void load_from_file(const std::string& filename);
+    /**
+     * Контрольная точка: файл базы переписывается в фоновом потоке, пока запросы продолжают выполняться.
+     * Записывается состояние на момент запуска: запрос, который собирается изменить ещё не записанную
+     * таблицу, передаёт контрольной точке её копию (copy-on-write) и меняет саму таблицу.
+     * Файл пишется во временный файл, атомарно заменяет файл базы, а журнал сокращается
+     * до фиксаций, сделанных после запуска.
+     *
+     * Инкрементальная контрольная точка дописывает в конец файла только изменённые таблицы:
+     * у таблицы с новыми строками и удалениями - добавленные строки и изменённые сегменты видимости,
+     * у таблицы с изменённой схемой, индексами или значениями на месте - таблицу целиком.
+     * Затем дописывается новый каталог, и заголовок переключается на него.
+     * Когда неиспользуемые части файла разрастаются, выполняется полная перезапись (уплотнение).
+     */
+    struct CheckpointPolicy {
+        uint64_t wal_bytes = uint64_t(64) << 20; ///< Размер журнала, при котором запускается контрольная точка (0 - не учитывается).
+        std::chrono::seconds interval{ 0 };      ///< Время с прошлой контрольной точки (0 - не учитывается).
+        bool incremental = true;                 ///< Дописывать изменения вместо полной перезаписи файла.
+        double compact_ratio = 1.0;              ///< Доля неиспользуемых байтов файла (к используемым), после которой файл переписывается.
+    };
+    // Условия проверяются после каждого запроса вне транзакции.
+    void set_checkpoint_policy(const CheckpointPolicy& policy);
+    // Запускает контрольную точку файла, с которым связана база (save_to_file / load_from_file).
+    // full - переписать файл целиком, даже если можно дописать изменения.
+    void checkpoint(bool full = false);
+    // Дожидается запущенной контрольной точки и завершает её.
+    void wait_for_checkpoint();
+    bool checkpoint_running() const { return std::atomic_load(&pending_checkpoint) != nullptr; }
 
-    //  .
+    // Открывает бинарный файл: читается только каталог таблиц, каждая таблица загружается
+    // при первом обращении через get_table. С preload все таблицы загружаются параллельно до возврата.
+    // Сохранённые индексы строятся при загрузке таблицы. Файлы прежнего текстового формата читаются целиком.
+    // Изменения из журнала <filename>.wal, не попавшие в файл, применяются заново.
+    void load_from_file(const std::string& filename, bool preload = false);
+
+    // Открывает бинарный файл без чтения данных: запросы читают столбцы прямо из отображённого файла.
+    // Изменяемый столбец копируется в память, сам файл не меняется до save_to_file.
+    // Журнал <filename>.wal применяется так же, как в load_from_file.
+    void open_mapped(const std::string& filename);
+
+    // Начало транзакции потока: запросы видят снимок базы на этот момент и свои изменения.
+    // Повторный вызов внутри транзакции начинает вложенную транзакцию.
     void begin_transaction();
 
-    //  .
+    // Откат транзакции.
     void rollback_transaction();
 
-    //  .
+    // Подтверждение транзакции.
     void commit_transaction();
 
+    // Точки сохранения внутри транзакции.
+    void savepoint(const std::string& name);
+    void rollback_to_savepoint(const std::string& name);
+    void release_savepoint(const std::string& name);
+
+    // Текущая транзакция потока (во время execute всегда есть).
+    Transaction* current_transaction();
+
 private:
-    std::map<std::string, std::shared_ptr<Table>> tables; //  
-    std::vector<std::map<std::string, std::shared_ptr<Table>>> transaction_stack; //   
+    // Положение таблицы в файле по каталогу
+    struct TableLocation {
+        uint64_t offset = 0;
+        uint64_t size = 0;
+        std::vector<TableLocation> deltas; // Дописанные изменения (Table::save_changes) по порядку
+    };
+    using Catalog = std::map<std::string, std::shared_ptr<Table>>;
+
+    static std::string encode_directory(const std::map<std::string, TableLocation>& locations, Timestamp checkpoint);
+    void load_text(std::istream& file);
+    Timestamp read_directory(std::string_view directory, uint64_t file_size);
+    std::shared_ptr<Table> read_table(const TableLocation& location) const;
+    static void check_region_end(const TableLocation& region, uint64_t end_position);
+    void load_all_tables();
+    std::shared_ptr<Table> find_table(const std::string& name);
+
+    // Опубликованный каталог; не освобождается, пока жив объект
+    class CatalogView {
+    public:
+        CatalogView(EpochDomain::Guard guard, const Catalog* catalog) : guard(std::move(guard)), catalog(catalog) {}
+        const Catalog& operator*() const { return *catalog; }
+        const Catalog* operator->() const { return catalog; }
+
+    private:
+        EpochDomain::Guard guard;
+        const Catalog* catalog;
+    };
+    CatalogView tables() const;
+    void publish(Catalog tables); // Под catalog_mutex
+    Transaction& start_transaction();
+    void finish_transaction(bool commit);
+    void rollback(Transaction& txn, size_t mark);
+    void apply_commit(Transaction& txn, Timestamp commit_ts, bool commit);
+    static std::vector<Table*> lock_order(const Transaction& txn);
+    std::vector<std::unique_lock<std::shared_mutex>> lock_for_write(const Transaction& txn);
+    Timestamp oldest_active_read();
+    std::string encode_commit(const Transaction& txn, Timestamp commit_ts) const;
+    void open_wal(const std::string& filename);
+    void replay_redo(storage::ByteCursor& in);
+    void ensure_no_transaction();
+    Transaction& active_transaction(const std::string& command);
+
+    std::atomic<const Catalog*> catalog{ new Catalog() }; // Хранилище таблиц; читается через tables()
+    mutable EpochDomain catalog_epochs; // Читатели каталога; прежние копии освобождаются через retire
+    std::mutex catalog_mutex; // Изменение каталога, unloaded_tables и исходного файла
+    std::map<std::string, TableLocation> unloaded_tables; // Таблицы исходного файла, ещё не прочитанные
+    std::string source_file; // Файл, из которого открыта база
+    std::shared_ptr<const storage::MappedFile> source_mapping; // Отображение source_file для open_mapped
+
+    // Потоки execute_async; создаются при первом асинхронном запросе
+    static constexpr unsigned kMinQueryThreads = 4; // Запросы ждут журнал и блокировки, поэтому потоков больше, чем ядер
+    std::once_flag executor_started;
+    std::unique_ptr<ThreadPool> executor;
+
+    std::mutex transactions_mutex;
+    std::map<std::thread::id, std::unique_ptr<Transaction>> transactions; // Активные транзакции по потокам
+    std::atomic<uint64_t> next_transaction_id{ 1 };
+
+    // Фиксации получают время и место в журнале по порядку под commit_mutex, ждут записи на диск
+    // вместе (групповая фиксация) и применяются к таблицам в том же порядке: снимок last_commit
+    // видит все фиксации до него целиком.
+    std::mutex commit_mutex;
+    std::condition_variable commit_applied;
+    Timestamp next_commit = 0;              // Последнее выданное время фиксации
+    std::atomic<Timestamp> last_commit{ 0 }; // Последняя применённая фиксация, снимок новых транзакций
+    std::unique_ptr<storage::WriteAheadLog> wal; // Журнал файла базы; нет у базы, не связанной с файлом
+    std::unique_lock<std::mutex> drain_commits(); // commit_mutex, когда все выданные фиксации применены
+
+    // Запущенная контрольная точка: снимок таблиц и результат фоновой записи
+    struct Checkpoint {
+        std::string filename;
+        std::string temp_filename;
+        bool incremental = false;  // Изменения дописываются в filename, а не пишется новый файл
+        Timestamp timestamp = 0;   // Последняя фиксация в снимке
+        uint64_t wal_position = 0; // Часть журнала, которую покрывает снимок
+
+        // Таблица снимка. Пока фоновый поток её не записал, изменяющий её запрос
+        // передаёт контрольной точке копию (hand_over) и дальше меняет саму таблицу.
+        struct Entry {
+            std::string name;
+            std::shared_ptr<Table> table;
+            std::shared_ptr<const Table> copy;
+            bool started = false;
+            Table::SaveMark mark; // Записанное состояние таблицы
+        };
+        std::vector<Entry> tables;
+        std::mutex mutex; // Поля started и copy
+        void hand_over(Table* table);
+
+        std::vector<std::pair<std::string, TableLocation>> unloaded; // Копируются из исходного файла
+        std::string source_file;
+        std::shared_ptr<const storage::MappedFile> source_mapping;
+        std::map<std::string, TableLocation> previous; // Каталог filename до инкрементальной записи
+        std::map<std::string, TableLocation> written;  // Положение таблиц в новом файле
+        std::future<void> done;
+    };
+    // Запуск и завершение контрольной точки; защищает и поля ниже
+    std::mutex checkpoint_mutex;
+    std::shared_ptr<Checkpoint> pending_checkpoint; // Читается запросами через std::atomic_load
+    CheckpointPolicy checkpoint_policy;
+    std::chrono::steady_clock::time_point last_checkpoint_time = std::chrono::steady_clock::now();
+    std::string database_file; // Файл, с которым связаны журнал и контрольные точки
+    std::map<std::string, TableLocation> file_directory; // Действующий каталог database_file
+
+    void start_checkpoint(const std::string& filename, bool full);
+    void finish_checkpoint();
+    bool compaction_due() const;
+    void maybe_checkpoint();
+    static void write_checkpoint(Checkpoint& checkpoint);
+    static void append_checkpoint(Checkpoint& checkpoint);
+    static void write_snapshot_table(Checkpoint& checkpoint, Checkpoint::Entry& entry,
+        const std::function<void(const Table&)>& write);
 };
 
 #endif // DATABASE_H
@@ -0,0 +1,72 @@
+#include "epoch.h"
+#include <algorithm>
+#include <iterator>
+#include <limits>
+#include <thread>
+
+EpochDomain::~EpochDomain() {
+    for (auto& object : retired) {
+        object.destroy();
+    }
+}
+
+EpochDomain::Guard& EpochDomain::Guard::operator=(Guard&& other) noexcept {
+    if (this != &other) {
+        release();
+        slot = other.slot;
+        other.slot = nullptr;
+    }
+    return *this;
+}
+
+void EpochDomain::Guard::release() {
+    if (slot) {
+        slot->epoch.store(0);
+        slot = nullptr;
+    }
+}
+
+EpochDomain::Guard EpochDomain::pin() {
+    // Потоки начинают поиск свободной ячейки с разных мест, чтобы не делить строку кэша
+    thread_local const size_t start = std::hash<std::thread::id>()(std::this_thread::get_id());
+    for (size_t attempt = 0;; ++attempt) {
+        Slot& slot = slots[(start + attempt) % kSlotCount];
+        uint64_t free = 0;
+        // Все операции seq_cst: если писатель, освобождая объект, увидел ячейку свободной,
+        // чтение указателя после закрепления уже видит замену
+        if (slot.epoch.load(std::memory_order_relaxed) == 0 && slot.epoch.compare_exchange_strong(free, current.load())) {
+            return Guard(&slot);
+        }
+        if (attempt % kSlotCount == kSlotCount - 1) {
+            std::this_thread::yield(); // Все ячейки заняты
+        }
+    }
+}
+
+uint64_t EpochDomain::oldest_pinned() const {
+    uint64_t oldest = std::numeric_limits<uint64_t>::max();
+    for (const Slot& slot : slots) {
+        uint64_t epoch = slot.epoch.load();
+        if (epoch != 0) {
+            oldest = std::min(oldest, epoch);
+        }
+    }
+    return oldest;
+}
+
+void EpochDomain::retire(std::function<void()> destroy) {
+    std::vector<Retired> ready;
+    {
+        std::lock_guard<std::mutex> lock(retired_mutex);
+        retired.push_back({ current.fetch_add(1) + 1, std::move(destroy) });
+
+        uint64_t oldest = oldest_pinned();
+        auto unused = std::partition(retired.begin(), retired.end(),
+            [oldest](const Retired& object) { return object.epoch > oldest; });
+        std::move(unused, retired.end(), std::back_inserter(ready));
+        retired.erase(unused, retired.end());
+    }
+    for (auto& object : ready) {
+        object.destroy(); // Вне блокировки: деструктор может быть долгим
+    }
+}
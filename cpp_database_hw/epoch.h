@@ -0,0 +1,82 @@
+#pragma once
+#ifndef EPOCH_H
+#define EPOCH_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+/**
+ * @class EpochDomain
+ * Отложенное освобождение объектов, которые читаются без блокировок (epoch-based reclamation).
+ *
+ * Читатель закрепляет текущую эпоху (pin) на время работы с объектом, полученным через атомарный указатель.
+ * Писатель сначала заменяет указатель, затем передаёт прежний объект в retire: объект освобождается,
+ * когда не остаётся читателей, закрепивших эпоху до замены.
+ */
+class EpochDomain {
+    struct alignas(64) Slot {
+        std::atomic<uint64_t> epoch{ 0 }; ///< Закреплённая эпоха читателя (0 - свободен).
+    };
+
+public:
+    EpochDomain() = default;
+    ~EpochDomain(); // Освобождает все отложенные объекты: читателей уже нет
+
+    EpochDomain(const EpochDomain&) = delete;
+    EpochDomain& operator=(const EpochDomain&) = delete;
+
+    /**
+     * @class Guard
+     * Закреплённая эпоха: объекты, прочитанные после pin, живы до разрушения Guard.
+     */
+    class Guard {
+    public:
+        Guard() = default;
+        Guard(Guard&& other) noexcept : slot(other.slot) { other.slot = nullptr; }
+        Guard& operator=(Guard&& other) noexcept;
+        ~Guard() { release(); }
+
+        Guard(const Guard&) = delete;
+        Guard& operator=(const Guard&) = delete;
+
+    private:
+        friend class EpochDomain;
+        explicit Guard(Slot* slot) : slot(slot) {}
+        void release();
+
+        Slot* slot = nullptr;
+    };
+
+    // Закрепляет текущую эпоху. Можно вызывать из любого потока, в том числе повторно.
+    Guard pin();
+
+    // Освобождает объект (вызывает destroy), когда его не может читать ни один закрепивший эпоху поток.
+    // Вызывается после того, как объект стал недоступен для новых читателей.
+    void retire(std::function<void()> destroy);
+
+    template <typename T>
+    void retire(const T* object) {
+        retire([object]() { delete object; });
+    }
+
+private:
+    static constexpr size_t kSlotCount = 64;
+
+    struct Retired {
+        uint64_t epoch; // Эпоха после замены: читатели с этой эпохой объект уже не видят
+        std::function<void()> destroy;
+    };
+
+    std::atomic<uint64_t> current{ 1 };
+    Slot slots[kSlotCount];
+    std::mutex retired_mutex;
+    std::vector<Retired> retired;
+
+    uint64_t oldest_pinned() const;
+};
+
+#endif // EPOCH_H
@@ -3,7 +3,222 @@
 #include <algorithm>
 #include <typeinfo>
 
+namespace {
+
+// Начала групп одинаковых ключей в упорядоченном списке строк; on_key вызывается для первой строки группы
+template <typename SameKey, typename OnKey>
+std::vector<uint64_t> group_starts(const std::vector<uint64_t>& order, SameKey same_key, OnKey on_key) {
+    std::vector<uint64_t> starts;
+    for (size_t i = 0; i < order.size(); ++i) {
+        if (i == 0 || !same_key(order[i - 1], order[i])) {
+            starts.push_back(i);
+            on_key(order[i]);
+        }
+    }
+    starts.push_back(order.size());
+    return starts;
+}
+
+} // namespace
+
+void PersistedIndex::save(storage::BinaryWriter& out, const Column& column, const std::vector<uint64_t>& deleted) {
+    std::vector<uint64_t> order;
+    for (size_t row = 0; row < column.size(); ++row) {
+        bool is_deleted = (row >> 6) < deleted.size() && ((deleted[row >> 6] >> (row & 63)) & 1);
+        if (!is_deleted && !column.is_null(row)) {
+            order.push_back(row);
+        }
+    }
+
+    // Устойчивая сортировка по ключу сохраняет возрастание номеров строк внутри группы
+    std::vector<uint64_t> starts;
+    std::vector<int32_t> int_keys;
+    std::vector<uint64_t> offsets;
+    std::vector<uint32_t> lengths;
+    std::string chars;
+    switch (column.type()) {
+    case ColumnType::Int32:
+    case ColumnType::Bool: {
+        auto key_of = [&column](uint64_t row) {
+            return column.type() == ColumnType::Int32 ? column.get_int(row) : int32_t(column.get_bool(row));
+        };
+        std::stable_sort(order.begin(), order.end(), [&](uint64_t a, uint64_t b) { return key_of(a) < key_of(b); });
+        starts = group_starts(order, [&](uint64_t a, uint64_t b) { return key_of(a) == key_of(b); },
+            [&](uint64_t row) { int_keys.push_back(key_of(row)); });
+        break;
+    }
+    case ColumnType::String:
+        std::stable_sort(order.begin(), order.end(), [&](uint64_t a, uint64_t b) {
+            return column.get_string(a) < column.get_string(b);
+        });
+        starts = group_starts(order, [&](uint64_t a, uint64_t b) { return column.get_string(a) == column.get_string(b); },
+            [&](uint64_t row) {
+                std::string_view value = column.get_string(row);
+                offsets.push_back(chars.size());
+                lengths.push_back(static_cast<uint32_t>(value.size()));
+                chars.append(value.data(), value.size());
+            });
+        break;
+    }
+
+    storage::ByteBuffer header;
+    header.put_u64(starts.size() - 1);
+    header.put_u64(order.size());
+    out.write_block(header.bytes());
+    if (column.type() == ColumnType::String) {
+        out.write_block(offsets);
+        out.write_block(lengths);
+        out.write_block(chars);
+    }
+    else {
+        out.write_block(int_keys);
+    }
+    out.write_block(starts);
+    out.write_block(order);
+}
+
+void PersistedIndex::attach(storage::MemoryReader& in, ColumnType type, size_t rows_in_table,
+    std::shared_ptr<const storage::MappedFile> file, bool verify) {
+    reset();
+    storage::ByteCursor header(in.read_block());
+    uint64_t key_total = header.get_u64();
+    uint64_t entry_total = header.get_u64();
+    if (key_total > entry_total || entry_total > rows_in_table) {
+        throw std::runtime_error("Corrupted index: entry count out of range.");
+    }
+    key_type = type;
+    keys = static_cast<size_t>(key_total);
+    entries = static_cast<size_t>(entry_total);
+    row_limit = rows_in_table;
+
+    if (type == ColumnType::String) {
+        key_offsets = in.read_array<uint64_t>(keys, verify);
+        key_lengths = in.read_array<uint32_t>(keys, verify);
+        std::string_view chars = in.read_block(verify);
+        key_chars = chars.data();
+        char_count = chars.size();
+    }
+    else {
+        int_keys = in.read_array<int32_t>(keys, verify);
+    }
+    starts = in.read_array<uint64_t>(keys + 1, verify);
+    row_numbers = in.read_array<uint64_t>(entries, verify);
+    mapping = std::move(file);
+}
+
+std::string_view PersistedIndex::string_key(size_t i) const {
+    if (key_offsets[i] > char_count || key_lengths[i] > char_count - key_offsets[i]) {
+        throw std::runtime_error("Corrupted index: key out of bounds.");
+    }
+    return std::string_view(key_chars + key_offsets[i], key_lengths[i]);
+}
+
+std::any PersistedIndex::key(size_t i) const {
+    switch (key_type) {
+    case ColumnType::Int32:
+        return static_cast<int>(int_keys[i]);
+    case ColumnType::String:
+        return std::string(string_key(i));
+    case ColumnType::Bool:
+        return int_keys[i] != 0;
+    }
+    return std::any();
+}
+
+IndexRows PersistedIndex::rows(size_t i) const {
+    uint64_t first = starts[i];
+    uint64_t last = starts[i + 1];
+    if (first > last || last > entries) {
+        throw std::runtime_error("Corrupted index: row group out of bounds.");
+    }
+    for (uint64_t k = first; k < last; ++k) {
+        if (row_numbers[k] >= row_limit) {
+            throw std::runtime_error("Corrupted index: row out of range.");
+        }
+    }
+    return IndexRows(row_numbers + first, static_cast<size_t>(last - first));
+}
+
+bool PersistedIndex::accepts(const std::any& key) const {
+    switch (key_type) {
+    case ColumnType::Int32:
+        return key.type() == typeid(int);
+    case ColumnType::String:
+        return key.type() == typeid(std::string);
+    case ColumnType::Bool:
+        return key.type() == typeid(bool);
+    }
+    return false;
+}
+
+int PersistedIndex::compare(size_t i, const std::any& key) const {
+    switch (key_type) {
+    case ColumnType::Int32: {
+        int value = std::any_cast<int>(key);
+        return (int_keys[i] > value) - (int_keys[i] < value);
+    }
+    case ColumnType::String: {
+        int result = string_key(i).compare(std::any_cast<const std::string&>(key));
+        return (result > 0) - (result < 0);
+    }
+    case ColumnType::Bool: {
+        int value = std::any_cast<bool>(key) ? 1 : 0;
+        int stored = int_keys[i] != 0 ? 1 : 0;
+        return stored - value;
+    }
+    }
+    return 0;
+}
+
+size_t PersistedIndex::lower_bound(const std::any& key) const {
+    if (!accepts(key)) {
+        throw std::runtime_error("Type mismatch during comparison.");
+    }
+    size_t first = 0, count = keys;
+    while (count > 0) {
+        size_t half = count / 2;
+        if (compare(first + half, key) < 0) {
+            first += half + 1;
+            count -= half + 1;
+        }
+        else {
+            count = half;
+        }
+    }
+    return first;
+}
+
+size_t PersistedIndex::upper_bound(const std::any& key) const {
+    if (!accepts(key)) {
+        throw std::runtime_error("Type mismatch during comparison.");
+    }
+    size_t first = 0, count = keys;
+    while (count > 0) {
+        size_t half = count / 2;
+        if (compare(first + half, key) <= 0) {
+            first += half + 1;
+            count -= half + 1;
+        }
+        else {
+            count = half;
+        }
+    }
+    return first;
+}
+
+IndexRows PersistedIndex::lookup(const std::any& key) const {
+    if (!accepts(key)) {
+        return {};
+    }
+    size_t i = lower_bound(key);
+    if (i < keys && compare(i, key) == 0) {
+        return rows(i);
+    }
+    return {};
+}
+
 void UnorderedIndex::add_entry(const std::any& key, size_t row_index) {
+    materialize();
     if (key.type() == typeid(int)) {
         int value = std::any_cast<int>(key);
         int_index_data[value].push_back(row_index);
@@ -12,28 +227,41 @@ void UnorderedIndex::add_entry(const std::any& key, size_t row_index) {
         std::string value = std::any_cast<std::string>(key);
         string_index_data[value].push_back(row_index);
     }
+    else if (key.type() == typeid(bool)) {
+        bool_index_data[std::any_cast<bool>(key)].push_back(row_index);
+    }
     else {
         throw std::invalid_argument("Unsupported key type for indexing.");
     }
 }
 
 std::vector<size_t> UnorderedIndex::find(const std::any& key) const {
+    IndexRows rows = lookup(key);
+    return std::vector<size_t>(rows.begin(), rows.end());
+}
+
+IndexRows UnorderedIndex::lookup(const std::any& key) const {
+    if (persisted.attached()) {
+        return persisted.lookup(key);
+    }
+    auto rows_of = [](const auto& map, const auto& value) {
+        auto it = map.find(value);
+        return it != map.end() ? IndexRows(it->second.data(), it->second.size()) : IndexRows();
+    };
     if (key.type() == typeid(int)) {
-        int value = std::any_cast<int>(key);
-        if (int_index_data.find(value) != int_index_data.end()) {
-            return int_index_data.at(value);
-        }
+        return rows_of(int_index_data, std::any_cast<int>(key));
     }
-    else if (key.type() == typeid(std::string)) {
-        std::string value = std::any_cast<std::string>(key);
-        if (string_index_data.find(value) != string_index_data.end()) {
-            return string_index_data.at(value);
-        }
+    if (key.type() == typeid(std::string)) {
+        return rows_of(string_index_data, std::any_cast<const std::string&>(key));
+    }
+    if (key.type() == typeid(bool)) {
+        return rows_of(bool_index_data, std::any_cast<bool>(key));
     }
     return {};
 }
 
 void UnorderedIndex::remove_entry(const std::any& key, size_t row_index) {
+    materialize();
     if (key.type() == typeid(int)) {
         int value = std::any_cast<int>(key);
         auto it = int_index_data.find(value);
@@ -56,4 +284,42 @@ void UnorderedIndex::remove_entry(const std::any& key, size_t row_index) {
             }
         }
     }
+    else if (key.type() == typeid(bool)) {
+        auto it = bool_index_data.find(std::any_cast<bool>(key));
+        if (it != bool_index_data.end()) {
+            auto& vec = it->second;
+            vec.erase(std::remove(vec.begin(), vec.end(), row_index), vec.end());
+            if (vec.empty()) {
+                bool_index_data.erase(it);
+            }
+        }
+    }
+}
+
+void UnorderedIndex::attach(PersistedIndex index) {
+    string_index_data.clear();
+    int_index_data.clear();
+    bool_index_data.clear();
+    persisted = std::move(index);
+}
+
+void UnorderedIndex::materialize() {
+    if (!persisted.attached()) {
+        return;
+    }
+    for (size_t i = 0; i < persisted.key_count(); ++i) {
+        IndexRows rows = persisted.rows(i);
+        switch (persisted.type()) {
+        case ColumnType::Int32:
+            int_index_data[persisted.int_key(i)].assign(rows.begin(), rows.end());
+            break;
+        case ColumnType::String:
+            string_index_data[std::string(persisted.string_key(i))].assign(rows.begin(), rows.end());
+            break;
+        case ColumnType::Bool:
+            bool_index_data[persisted.int_key(i) != 0].assign(rows.begin(), rows.end());
+            break;
+        }
+    }
+    persisted.reset();
 }
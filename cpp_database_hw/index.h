@@ -2,30 +2,115 @@
 #include <unordered_map>
 #include <vector>
 #include <any>
+#include <cstdint>
+#include <memory>
 #include <string>
+#include <string_view>
+#include "column.h"
+#include "storage_format.h"
+#include "mapped_file.h"
+
+/**
+ * @class IndexRows
+ * Номера строк одного ключа индекса: указатель на массив без копирования
+ * (в хеш-таблицу индекса или в отображённый файл).
+ */
+class IndexRows {
+public:
+    IndexRows() = default;
+    IndexRows(const uint64_t* first, size_t count) : first(first), count(count) {}
+
+    const uint64_t* begin() const { return first; }
+    const uint64_t* end() const { return first + count; }
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+
+private:
+    const uint64_t* first = nullptr;
+    size_t count = 0;
+};
+
+/**
+ * @class PersistedIndex
+ * Индекс, записанный в файл: ключи по возрастанию, для каждого ключа начало его группы
+ * и номера строк групп подряд (внутри группы по возрастанию).
+ *
+ * Блоки: заголовок (u64 ключей, u64 строк), ключи (int32 для int32 и bool; для строк смещения u64,
+ * длины u32 и символы), начала групп u64[ключей + 1], номера строк u64[строк].
+ * Поиск - двоичный поиск по ключам прямо в блоках. Границы групп, номера строк и строковые ключи
+ * проверяются при чтении, поэтому подключение не читает страницы индекса заранее.
+ */
+class PersistedIndex {
+public:
+    // Записывает индекс по значениям столбца; строки, отмеченные в deleted, и NULL не попадают в индекс.
+    static void save(storage::BinaryWriter& out, const Column& column, const std::vector<uint64_t>& deleted);
+
+    // Подключает блоки индекса. row_limit - число позиций строк таблицы; file держит отображение,
+    // пока индекс на него указывает (nullptr, если буфер принадлежит вызывающему).
+    void attach(storage::MemoryReader& in, ColumnType type, size_t row_limit,
+        std::shared_ptr<const storage::MappedFile> file, bool verify);
+    bool attached() const { return starts != nullptr; }
+    void reset() { *this = PersistedIndex(); }
+
+    ColumnType type() const { return key_type; }
+    size_t key_count() const { return keys; }
+    int32_t int_key(size_t i) const { return int_keys[i]; } // Ключ столбца int32 или bool
+    std::string_view string_key(size_t i) const;
+    std::any key(size_t i) const;
+    IndexRows rows(size_t i) const;
+
+    // Позиции ключей, как у std::lower_bound и std::upper_bound; ключ другого типа - ошибка сравнения.
+    size_t lower_bound(const std::any& key) const;
+    size_t upper_bound(const std::any& key) const;
+    IndexRows lookup(const std::any& key) const; // Пусто, если ключа нет или он другого типа
+
+private:
+    ColumnType key_type = ColumnType::Int32;
+    size_t keys = 0;
+    size_t entries = 0;
+    size_t row_limit = 0;
+    const int32_t* int_keys = nullptr;
+    const uint64_t* key_offsets = nullptr;
+    const uint32_t* key_lengths = nullptr;
+    const char* key_chars = nullptr;
+    size_t char_count = 0;
+    const uint64_t* starts = nullptr;
+    const uint64_t* row_numbers = nullptr;
+    std::shared_ptr<const storage::MappedFile> mapping;
+
+    bool accepts(const std::any& key) const;
+    int compare(size_t i, const std::any& key) const; // Ключ i относительно key: <0, 0, >0
+};
 
 class UnorderedIndex {
 private:
-    std::unordered_map<std::string, std::vector<size_t>> string_index_data;
-    std::unordered_map<int, std::vector<size_t>> int_index_data;
+    std::unordered_map<std::string, std::vector<uint64_t>> string_index_data;
+    std::unordered_map<int, std::vector<uint64_t>> int_index_data;
+    std::unordered_map<bool, std::vector<uint64_t>> bool_index_data;
+    PersistedIndex persisted; // Подключённый индекс файла; перед первым изменением копируется в хеш-таблицы
 
 public:
     UnorderedIndex() = default;
     ~UnorderedIndex() = default;
 
-    //  
+    // Копирующий конструктор
     UnorderedIndex(const UnorderedIndex& other) = default;
 
-    //  
+    // Оператор копирования
     UnorderedIndex& operator=(const UnorderedIndex& other) = default;
 
-    //  
+    // Перемещающий конструктор
     UnorderedIndex(UnorderedIndex&& other) noexcept = default;
 
-    //  
+    // Оператор перемещения
     UnorderedIndex& operator=(UnorderedIndex&& other) noexcept = default;
 
     void add_entry(const std::any& key, size_t row_index);
     std::vector<size_t> find(const std::any& key) const;
+    IndexRows lookup(const std::any& key) const; // Как find, но без копирования
     void remove_entry(const std::any& key, size_t row_index);
+
+    void attach(PersistedIndex index); // Поиск идёт по блокам файла до первого изменения
+    bool is_mapped() const { return persisted.attached(); }
+    void materialize(); // Копирует подключённый индекс в хеш-таблицы
 };
@@ -0,0 +1,142 @@
+#include "lexer.h"
+#include <stdexcept>
+
+namespace {
+
+bool is_word_char(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+}
+
+bool is_digit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+bool is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+} // namespace
+
+Token Lexer::next() {
+    Token token = current;
+    current = scan();
+    return token;
+}
+
+Token Lexer::expect(Token::Kind kind, const char* what) {
+    if (current.kind != kind) {
+        fail(what);
+    }
+    return next();
+}
+
+void Lexer::expect_word(std::string_view word, const char* what) {
+    if (!current.is_word(word)) {
+        fail(what);
+    }
+    next();
+}
+
+bool Lexer::accept_word(std::string_view word) {
+    if (!current.is_word(word)) {
+        return false;
+    }
+    next();
+    return true;
+}
+
+bool Lexer::accept(Token::Kind kind) {
+    if (current.kind != kind) {
+        return false;
+    }
+    next();
+    return true;
+}
+
+void Lexer::fail(const std::string& message) const {
+    std::string found = current.kind == Token::Kind::End ? "end of query" : "'" + std::string(current.text) + "'";
+    throw std::runtime_error("Syntax error: " + message + " (found " + found + " at position " +
+        std::to_string(current.position) + ").");
+}
+
+Token Lexer::scan() {
+    while (offset < input.size() && is_space(input[offset])) {
+        ++offset;
+    }
+    Token token;
+    token.position = offset;
+    if (offset == input.size()) {
+        return token;
+    }
+
+    size_t start = offset;
+    char c = input[offset];
+    auto single = [&](Token::Kind kind) {
+        token.kind = kind;
+        token.text = input.substr(start, 1);
+        ++offset;
+        return token;
+    };
+
+    // Число: знак допускается только перед цифрой
+    if (is_digit(c) || ((c == '-' || c == '+') && offset + 1 < input.size() && is_digit(input[offset + 1]))) {
+        ++offset;
+        while (offset < input.size() && is_digit(input[offset])) {
+            ++offset;
+        }
+        token.kind = Token::Kind::Number;
+        if (offset < input.size() && is_word_char(input[offset])) {
+            if (!is_digit(c)) {
+                throw std::runtime_error("Syntax error: invalid number at position " + std::to_string(start) + ".");
+            }
+            // Имя, начинающееся с цифр
+            while (offset < input.size() && is_word_char(input[offset])) {
+                ++offset;
+            }
+            token.kind = Token::Kind::Word;
+        }
+        token.text = input.substr(start, offset - start);
+        return token;
+    }
+    if (is_word_char(c)) {
+        while (offset < input.size() && is_word_char(input[offset])) {
+            ++offset;
+        }
+        token.kind = Token::Kind::Word;
+        token.text = input.substr(start, offset - start);
+        return token;
+    }
+    if (c == '\'') {
+        size_t end = input.find('\'', offset + 1);
+        if (end == std::string_view::npos) {
+            throw std::runtime_error("Syntax error: unterminated string at position " + std::to_string(start) + ".");
+        }
+        token.kind = Token::Kind::String;
+        token.text = input.substr(start + 1, end - start - 1);
+        offset = end + 1;
+        return token;
+    }
+
+    switch (c) {
+    case '(': return single(Token::Kind::LeftParen);
+    case ')': return single(Token::Kind::RightParen);
+    case ',': return single(Token::Kind::Comma);
+    case ':': return single(Token::Kind::Colon);
+    case '.': return single(Token::Kind::Dot);
+    case '*': return single(Token::Kind::Star);
+    case '?': return single(Token::Kind::Question);
+    case '=': return single(Token::Kind::Equal);
+    case '<':
+    case '>':
+        if (offset + 1 < input.size() && input[offset + 1] == '=') {
+            token.kind = c == '<' ? Token::Kind::LessEqual : Token::Kind::GreaterEqual;
+            token.text = input.substr(start, 2);
+            offset += 2;
+            return token;
+        }
+        return single(c == '<' ? Token::Kind::Less : Token::Kind::Greater);
+    default:
+        throw std::runtime_error("Syntax error: unexpected character '" + std::string(1, c) +
+            "' at position " + std::to_string(start) + ".");
+    }
+}
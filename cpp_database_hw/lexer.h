@@ -0,0 +1,70 @@
+#pragma once
+#ifndef LEXER_H
+#define LEXER_H
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+/**
+ * @brief Лексема запроса. Текст лексемы - срез исходной строки, лексемы ничего не копируют.
+ */
+struct Token {
+    enum class Kind {
+        End,
+        Word,         ///< Имя или ключевое слово: буквы, цифры, '_'
+        Number,       ///< Целое со знаком
+        String,       ///< Строка в одинарных кавычках; text - без кавычек
+        LeftParen,
+        RightParen,
+        Comma,
+        Colon,
+        Dot,
+        Star,
+        Question,     ///< Параметр подготовленного запроса
+        Equal,
+        Less,
+        LessEqual,
+        Greater,
+        GreaterEqual
+    };
+
+    Kind kind = Kind::End;
+    std::string_view text;
+    size_t position = 0; ///< Смещение в запросе (для сообщений об ошибках)
+
+    bool is_word(std::string_view word) const { return kind == Kind::Word && text == word; }
+};
+
+/**
+ * @class Lexer
+ * Разбивает запрос на лексемы по одной, по мере запроса парсером.
+ * Строка запроса должна жить, пока используются лексемы.
+ */
+class Lexer {
+public:
+    explicit Lexer(std::string_view input) : input(input) { current = scan(); }
+
+    const Token& peek() const { return current; }
+    Token next();
+
+    // Следующая лексема, если она нужного вида (или ключевое слово word); иначе ошибка с текстом what.
+    Token expect(Token::Kind kind, const char* what);
+    void expect_word(std::string_view word, const char* what);
+    // Пропускает лексему, если это ключевое слово word.
+    bool accept_word(std::string_view word);
+    bool accept(Token::Kind kind);
+
+    [[noreturn]] void fail(const std::string& message) const;
+
+    std::string_view source() const { return input; }
+
+private:
+    std::string_view input;
+    size_t offset = 0;
+    Token current;
+
+    Token scan();
+};
+
+#endif // LEXER_H
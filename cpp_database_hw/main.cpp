@@ -1,6 +1,10 @@
 #include "database.h"
+#include <filesystem>
 #include <iostream>
+#include <future>
 #include <string>
+#include <thread>
+#include <vector>
 
 void test_create_insert();
 void test_select();
@@ -152,19 +156,19 @@ void test_join() {
     }
 }
 
-// 6. Test 
+// 6. Test Транзакции
 void test_transactions() {
     try {
         Database db;
 
         std::cout << "Running TRANSACTIONS test...\n";
 
-        // ===   ===
+        // === Создание таблицы ===
         std::cout << "Creating table 'users'...\n";
-        db.execute("CREATE TABLE users (id:int32,name:string,is_admin:bool)");
+        db.execute("CREATE TABLE users (id:int32 PRIMARY KEY,name:string,is_admin:bool)");
         std::cout << "Table 'users' created successfully.\n";
 
-        // ===   ===
+        // === Вставка данных ===
         db.execute("INSERT TO users (id=1,name='Alice',is_admin=false)");
         db.execute("INSERT TO users (id=2,name='Bob',is_admin=true)");
         db.execute("INSERT TO users (id=3,name='Charlie',is_admin=false)");
@@ -172,40 +176,194 @@ void test_transactions() {
         db.execute("INSERT TO users (id=5,name='Eve',is_admin=false)");
         std::cout << "Rows inserted into 'users'.\n";
 
-        // ===   ===
+        // Первичный ключ проверяется по хеш-индексу, который создаётся вместе с таблицей
+        try {
+            db.execute("INSERT TO users (id=1,name='Duplicate',is_admin=false)");
+        }
+        catch (const std::exception& e) {
+            std::cout << "Duplicate rejected: " << e.what() << "\n";
+        }
+
+        // === Создание индексов ===
         db.execute("CREATE INDEX ON users (id)");
         db.execute("CREATE INDEX ON users (is_admin)");
+        db.execute("CREATE ORDERED INDEX ON users (id)");
         std::cout << "Indexes created on 'id' and 'is_admin'.\n";
 
-        // ===   ===
+        // === Проверка индекса ===
         std::cout << "Range query with index:\n";
         std::cout << db.execute("SELECT * FROM users WHERE id >= 2 AND id <= 4") << std::endl;
 
-        // ===      ===
+        // === Тест с большой базой данных ===
         for (int i = 6; i <= 10000; ++i) {
             db.execute("INSERT TO users (id=" + std::to_string(i) + ",name='User" + std::to_string(i) + "',is_admin=false)");
         }
         std::cout << "Inserted large dataset.\n";
 
-        // ===   ===
+        // Подготовленный запрос разбирается один раз, при выполнении подставляются только значения
+        PreparedStatement insert_user = db.prepare("INSERT TO users (id=?,name=?,is_admin=false)");
+        for (int i = 12001; i <= 13000; ++i) {
+            insert_user.bind(1, i).bind(2, "User" + std::to_string(i)).execute();
+        }
+        std::cout << "Inserted with prepared statement:\n" << db.execute("SELECT * FROM users WHERE id >= 12998 AND id <= 13000") << std::endl;
+
+        // Курсор читает строки по одной: после трёх строк проход останавливается, остальные не проверяются.
+        // Пока курсор открыт, таблица заблокирована для чтения, поэтому он закрывается до следующих изменений.
+        {
+            Cursor cursor = db.query("SELECT * FROM users WHERE is_admin = false");
+            size_t id_column = cursor.column_index("id");
+            size_t name_column = cursor.column_index("name");
+            for (int shown = 0; shown < 3 && cursor.next(); ++shown) {
+                RowView row = cursor.row();
+                std::cout << "Cursor row: " << row.get_int(id_column) << " " << row.get_string(name_column) << "\n";
+            }
+        }
+
+        // === Тест транзакций ===
         db.begin_transaction();
         for (int i = 10001; i <= 11000; ++i) {
             db.execute("INSERT TO users (id=" + std::to_string(i) + ",name='TxUser" + std::to_string(i) + "',is_admin=true)");
         }
         db.rollback_transaction();
-        std::cout << "Rows after rollback:\n" << db.execute("SELECT * FROM users WHERE id >= 10001") << std::endl;
+        std::cout << "Rows after rollback:\n" << db.execute("SELECT * FROM users WHERE id >= 10001 AND id <= 11000") << std::endl;
 
         db.begin_transaction();
         for (int i = 11001; i <= 12000; ++i) {
             db.execute("INSERT TO users (id=" + std::to_string(i) + ",name='TxUser" + std::to_string(i) + "',is_admin=false)");
         }
         db.commit_transaction();
-        std::cout << "Rows after commit:\n" << db.execute("SELECT * FROM users WHERE id >= 11001") << std::endl;
+        std::cout << "Rows after commit:\n" << db.execute("SELECT * FROM users WHERE id >= 11001 AND id <= 12000") << std::endl;
 
-        // ===   ===
+        // Пакетная вставка: 1000 строк одним запросом
+        std::string batch = "INSERT TO users (id,name,is_admin) VALUES ";
+        for (int i = 13001; i <= 14000; ++i) {
+            batch += (i > 13001 ? ",(" : "(") + std::to_string(i) + ",'BatchUser" + std::to_string(i) + "',false)";
+        }
+        db.begin_transaction();
+        db.execute(batch);
+        db.commit_transaction();
+        std::cout << "Rows after batch commit:\n" << db.execute("SELECT * FROM users WHERE id >= 13998 AND id <= 14000") << std::endl;
+
+        // === Точки сохранения ===
+        db.execute("BEGIN");
+        db.execute("INSERT TO users (id=20001,name='Kept',is_admin=false)");
+        db.execute("SAVEPOINT before_second");
+        db.execute("INSERT TO users (id=20002,name='Discarded',is_admin=false)");
+        db.execute("ROLLBACK TO SAVEPOINT before_second");
+        db.execute("COMMIT");
+        std::cout << "Rows after savepoint rollback:\n" << db.execute("SELECT * FROM users WHERE id >= 20001") << std::endl;
+
+        // === Снимки транзакций: фиксация другого потока не видна до конца транзакции ===
+        db.begin_transaction();
+        std::cout << "Snapshot before concurrent update:\n" << db.execute("SELECT * FROM users WHERE id = 2") << std::endl;
+        std::thread([&db] { db.execute("UPDATE users SET name='Robert' WHERE id = 2"); }).join();
+        std::cout << "Snapshot after concurrent update:\n" << db.execute("SELECT * FROM users WHERE id = 2") << std::endl;
+        // Строку уже изменила зафиксированная транзакция: второй писатель получает конфликт
+        try {
+            db.execute("UPDATE users SET name='Bobby' WHERE id = 2");
+        }
+        catch (const std::exception& e) {
+            std::cout << "Second writer rejected: " << e.what() << "\n";
+        }
+        db.rollback_transaction();
+        std::cout << "Row after snapshot ends:\n" << db.execute("SELECT * FROM users WHERE id = 2") << std::endl;
+
+        // === Повторные изменения: позиции освобождённых версий занимаются снова, файл не растёт с историей ===
+        {
+            Database counters;
+            counters.execute("CREATE TABLE counters (id:int32 PRIMARY KEY,value:int32)");
+            for (int id = 1; id <= 10; ++id) {
+                counters.execute("INSERT TO counters (id=" + std::to_string(id) + ",value=0)");
+            }
+            counters.save_to_file("db_updates.bin");
+            auto size_before = std::filesystem::file_size("db_updates.bin");
+            for (int i = 0; i < 1000; ++i) {
+                counters.execute("UPDATE counters SET value=" + std::to_string(i) + " WHERE id = " + std::to_string(i % 10 + 1));
+            }
+            counters.save_to_file("db_updates.bin");
+            bool bounded = std::filesystem::file_size("db_updates.bin") < 2 * size_before;
+            std::cout << "File size bounded under repeated updates: " << (bounded ? "yes" : "no") << "\n";
+        }
+        std::filesystem::remove("db_updates.bin");
+        std::filesystem::remove("db_updates.bin.wal");
+
+        // === Параллельные запросы: каждый поток выполняет свои транзакции ===
+        std::vector<std::thread> writers;
+        for (int t = 0; t < 4; ++t) {
+            writers.emplace_back([&db, t] {
+                for (int i = 0; i < 3; ++i) {
+                    int id = 40001 + t * 3 + i;
+                    db.execute("INSERT TO users (id=" + std::to_string(id) + ",name='Thread" + std::to_string(t) + "',is_admin=false)");
+                }
+            });
+        }
+        for (std::thread& writer : writers) {
+            writer.join();
+        }
+        std::cout << "Rows inserted by concurrent threads:\n" << db.execute("SELECT * FROM users WHERE id >= 40001") << std::endl;
+
+        // === Асинхронные запросы: вызывающий поток ставит их в очередь и забирает результаты позже ===
+        std::vector<std::future<std::string>> pending;
+        for (int id = 50001; id <= 50005; ++id) {
+            pending.push_back(db.execute_async("INSERT TO users (id=" + std::to_string(id) + ",name='Async',is_admin=false)"));
+        }
+        for (auto& result : pending) {
+            result.get();
+        }
+        std::cout << "Rows inserted asynchronously:\n" << db.execute_async("SELECT * FROM users WHERE id >= 50001").get() << std::endl;
+
+        // === Сохранение данных ===
         db.save_to_file("db_large.bin");
         std::cout << "Data saved to 'db_large.bin'.\n";
 
+        // === Индексы читаются из отображённого файла без построения ===
+        {
+            Database mapped;
+            mapped.open_mapped("db_large.bin");
+            bool lookups_match = true;
+            for (const char* query : { "SELECT * FROM users WHERE id = 12345", "SELECT * FROM users WHERE id >= 49990",
+                                       "SELECT * FROM users WHERE is_admin = true AND id < 100" }) {
+                lookups_match = lookups_match && mapped.execute(query) == db.execute(query);
+            }
+            std::cout << "Mapped index lookups match: " << (lookups_match ? "yes" : "no") << "\n";
+        }
+
+        // === Журнал WAL: изменения после сохранения восстанавливаются при открытии ===
+        db.execute("INSERT TO users (id=30001,name='Logged',is_admin=false)");
+        Database reopened;
+        reopened.load_from_file("db_large.bin");
+        std::cout << "Rows restored from write-ahead log:\n" << reopened.execute("SELECT * FROM users WHERE id >= 30001") << std::endl;
+
+        // === Отображение файла: столбцы читаются прямо из файла, журнал применяется так же ===
+        // Отображение закрывается до контрольной точки, которая заменяет файл
+        {
+            Database mapped;
+            mapped.open_mapped("db_large.bin");
+            bool mapped_matches = mapped.execute("SELECT * FROM users") == db.execute("SELECT * FROM users");
+            std::cout << "Mapped database matches: " << (mapped_matches ? "yes" : "no") << "\n";
+        }
+
+        // === Контрольная точка в фоне: запрос выполняется, пока файл переписывается ===
+        db.checkpoint(true);
+        db.execute("INSERT TO users (id=30002,name='DuringCheckpoint',is_admin=false)");
+        db.wait_for_checkpoint();
+        Database checkpointed;
+        checkpointed.load_from_file("db_large.bin");
+        bool checkpoint_matches = checkpointed.execute("SELECT * FROM users") == db.execute("SELECT * FROM users");
+        std::cout << "Database after checkpoint matches: " << (checkpoint_matches ? "yes" : "no") << "\n";
+
+        // === Инкрементальная контрольная точка: новые строки дописываются в конец файла ===
+        auto size_before = std::filesystem::file_size("db_large.bin");
+        for (int id = 30003; id <= 30012; ++id) {
+            db.execute("INSERT TO users (id=" + std::to_string(id) + ",name='Appended',is_admin=false)");
+        }
+        db.checkpoint();
+        db.wait_for_checkpoint();
+        Database appended;
+        appended.load_from_file("db_large.bin");
+        bool appended_matches = appended.execute("SELECT * FROM users") == db.execute("SELECT * FROM users");
+        std::cout << "File extended by incremental checkpoint: " << (std::filesystem::file_size("db_large.bin") > size_before ? "yes" : "no") << "\n";
+        std::cout << "Database after incremental checkpoint matches: " << (appended_matches ? "yes" : "no") << "\n";
     }
     catch (const std::exception& e) {
         std::cerr << "Error in TRANSACTIONS test: " << e.what() << std::endl;
@@ -0,0 +1,80 @@
+#include "mapped_file.h"
+#include <stdexcept>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace storage {
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const std::string& filename) : filename(filename) {
+    HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error("Failed to open file for mapping: " + filename);
+    }
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0) {
+        CloseHandle(file);
+        throw std::runtime_error("Cannot map empty or unreadable file: " + filename);
+    }
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping) {
+        CloseHandle(file);
+        throw std::runtime_error("Failed to map file: " + filename);
+    }
+    void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!view) {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        throw std::runtime_error("Failed to map file: " + filename);
+    }
+    file_handle = file;
+    mapping_handle = mapping;
+    bytes = static_cast<const char*>(view);
+    length = static_cast<size_t>(file_size.QuadPart);
+}
+
+MappedFile::~MappedFile() {
+    UnmapViewOfFile(bytes);
+    CloseHandle(mapping_handle);
+    CloseHandle(file_handle);
+}
+
+#else
+
+MappedFile::MappedFile(const std::string& filename) : filename(filename) {
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Failed to open file for mapping: " + filename);
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size == 0) {
+        close(fd);
+        throw std::runtime_error("Cannot map empty or unreadable file: " + filename);
+    }
+    void* view = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); // Отображение остаётся действительным после закрытия дескриптора
+    if (view == MAP_FAILED) {
+        throw std::runtime_error("Failed to map file: " + filename);
+    }
+    bytes = static_cast<const char*>(view);
+    length = static_cast<size_t>(info.st_size);
+}
+
+MappedFile::~MappedFile() {
+    munmap(const_cast<char*>(bytes), length);
+}
+
+#endif
+
+} // namespace storage
@@ -0,0 +1,39 @@
+#pragma once
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <string>
+
+namespace storage {
+
+/**
+ * @class MappedFile
+ * Файл, отображённый в память только для чтения.
+ * Страницы подгружаются операционной системой по первому обращению.
+ */
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& filename);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char* data() const { return bytes; }
+    size_t size() const { return length; }
+    const std::string& name() const { return filename; }
+
+private:
+    std::string filename;
+    const char* bytes = nullptr;
+    size_t length = 0;
+#ifdef _WIN32
+    void* file_handle = nullptr;
+    void* mapping_handle = nullptr;
+#endif
+};
+
+} // namespace storage
+
+#endif // MAPPED_FILE_H
@@ -1,43 +1,32 @@
 #include "ordered_index.h"
 #include <iostream>
 #include <type_traits>
+#include <algorithm>
 
 /**
- * @brief  .
+ * @brief Конструктор перемещения.
  */
 OrderedUnorderedIndex::OrderedUnorderedIndex(OrderedUnorderedIndex&& other) noexcept
-    : index_map(std::move(other.index_map)) {}
+    : index_map(std::move(other.index_map)), persisted(std::move(other.persisted)) {}
 
 /**
- * @brief  .
+ * @brief Оператор перемещения.
  */
 OrderedUnorderedIndex& OrderedUnorderedIndex::operator=(OrderedUnorderedIndex&& other) noexcept {
     if (this != &other) {
         index_map = std::move(other.index_map);
+        persisted = std::move(other.persisted);
     }
     return *this;
 }
 
 /**
- * @brief    .
+ * @brief Добавить запись в индекс.
  */
 void OrderedUnorderedIndex::add_entry(const std::any& value, size_t row_id) {
+    materialize();
     try {
         index_map[value].insert(row_id);
-        std::cout << "Added entry to index: value=";
-        if (value.type() == typeid(int)) {
-            std::cout << std::any_cast<int>(value);
-        }
-        else if (value.type() == typeid(std::string)) {
-            std::cout << std::any_cast<std::string>(value);
-        }
-        else if (value.type() == typeid(bool)) {
-            std::cout << std::boolalpha << std::any_cast<bool>(value);
-        }
-        else {
-            std::cout << "[unsupported type]";
-        }
-        std::cout << ", row_id=" << row_id << std::endl;
     }
     catch (const std::exception& e) {
         throw std::runtime_error("Failed to add entry to index: " + std::string(e.what()));
@@ -45,9 +34,10 @@ void OrderedUnorderedIndex::add_entry(const std::any& value, size_t row_id) {
 }
 
 /**
- * @brief    .
+ * @brief Удалить запись из индекса.
  */
 void OrderedUnorderedIndex::remove_entry(const std::any& value, size_t row_id) {
+    materialize();
     auto it = index_map.find(value);
     if (it != index_map.end()) {
         it->second.erase(row_id);
@@ -58,7 +48,7 @@ void OrderedUnorderedIndex::remove_entry(const std::any& value, size_t row_id) {
 }
 
 /**
- * @brief      std::any.
+ * @brief Функция для сравнения двух значений std::any.
  */
 bool compare_any(const std::any& a, const std::any& b) {
     if (a.type() != b.type()) {
@@ -101,23 +91,94 @@ bool compare_any_order(const std::any& a, const std::any& b) {
 
 
 /**
- * @brief      .
+ * @brief Найти строки в заданном диапазоне значений.
  */
 std::set<size_t> OrderedUnorderedIndex::find_range(const std::any& min_val, const std::any& max_val) const {
+    if (persisted.attached()) {
+        size_t first = persisted.lower_bound(min_val);
+        size_t last = std::max(first, persisted.lower_bound(max_val));
+        std::vector<size_t> rows = persisted_rows(first, last);
+        return std::set<size_t>(rows.begin(), rows.end());
+    }
     std::set<size_t> result;
 
     auto it = index_map.lower_bound(min_val);
     while (it != index_map.end() && compare_any_order(it->first, max_val)) {
         result.insert(it->second.begin(), it->second.end());
-        ++it; // ,   
+        ++it; // Убедитесь, что итератор продвигается
     }
 
     return result;
 }
 
 /**
- * @brief  .
+ * @brief Найти строки между границами; отсутствующая граница означает открытый диапазон.
+ * @return Номера строк по возрастанию.
+ */
+std::vector<size_t> OrderedUnorderedIndex::find_range(const std::optional<IndexBound>& lower, const std::optional<IndexBound>& upper) const {
+    if (persisted.attached()) {
+        size_t first = 0;
+        if (lower) {
+            first = lower->inclusive ? persisted.lower_bound(lower->value) : persisted.upper_bound(lower->value);
+        }
+        size_t last = persisted.key_count();
+        if (upper) {
+            last = upper->inclusive ? persisted.upper_bound(upper->value) : persisted.lower_bound(upper->value);
+        }
+        return persisted_rows(first, std::max(first, last));
+    }
+    auto it = index_map.begin();
+    if (lower) {
+        it = lower->inclusive ? index_map.lower_bound(lower->value) : index_map.upper_bound(lower->value);
+    }
+    auto last = index_map.end();
+    if (upper) {
+        last = upper->inclusive ? index_map.upper_bound(upper->value) : index_map.lower_bound(upper->value);
+    }
+
+    std::vector<size_t> result;
+    for (; it != last && it != index_map.end(); ++it) {
+        // Пустой диапазон: нижняя граница оказалась правее верхней
+        if (upper && compare_any_order(upper->value, it->first)) {
+            break;
+        }
+        result.insert(result.end(), it->second.begin(), it->second.end());
+    }
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+/**
+ * @brief Очистить индекс.
  */
 void OrderedUnorderedIndex::clear() {
     index_map.clear();
+    persisted.reset();
+}
+
+void OrderedUnorderedIndex::attach(PersistedIndex index) {
+    index_map.clear();
+    persisted = std::move(index);
+}
+
+void OrderedUnorderedIndex::materialize() {
+    if (!persisted.attached()) {
+        return;
+    }
+    for (size_t i = 0; i < persisted.key_count(); ++i) {
+        IndexRows rows = persisted.rows(i);
+        // Ключи файла уже упорядочены, поэтому каждый вставляется в конец дерева
+        index_map.emplace_hint(index_map.end(), persisted.key(i), std::set<size_t>(rows.begin(), rows.end()));
+    }
+    persisted.reset();
+}
+
+std::vector<size_t> OrderedUnorderedIndex::persisted_rows(size_t first, size_t last) const {
+    std::vector<size_t> result;
+    for (size_t i = first; i < last; ++i) {
+        IndexRows rows = persisted.rows(i);
+        result.insert(result.end(), rows.begin(), rows.end());
+    }
+    std::sort(result.begin(), result.end());
+    return result;
 }
@@ -5,27 +5,41 @@
 #include <map>
 #include <set>
 #include <any>
+#include <optional>
 #include <stdexcept>
+#include <vector>
+#include "index.h"
 
 /**
- * @brief      std::any.
+ * @brief Функция для сравнения двух значений std::any.
  */
 bool compare_any(const std::any& a, const std::any& b);
 
 /**
- * @brief      std::any.
- * ,    ,  .
+ * @brief Функция для сравнения двух значений std::any.
+ * Проверяет, меньше ли первое значение, чем второе.
  */
 bool compare_any_order(const std::any& a, const std::any& b);
 
 
+/**
+ * @brief Граница диапазона для поиска в упорядоченном индексе.
+ */
+struct IndexBound {
+    std::any value;
+    bool inclusive = true; ///< Включать ли само значение границы.
+};
+
 /**
  * @class OrderedUnorderedIndex
- *         .
+ * Реализация упорядоченного индекса для быстрого доступа по диапазонам значений.
  */
 class OrderedUnorderedIndex {
 public:
-    OrderedUnorderedIndex() = default; ///<   .
+    OrderedUnorderedIndex() = default; ///< Конструктор по умолчанию.
+
+    OrderedUnorderedIndex(const OrderedUnorderedIndex& other) = default; ///< Копирующий конструктор.
+    OrderedUnorderedIndex& operator=(const OrderedUnorderedIndex& other) = default; ///< Оператор копирования.
 
     OrderedUnorderedIndex(OrderedUnorderedIndex&& other) noexcept;
     OrderedUnorderedIndex& operator=(OrderedUnorderedIndex&& other) noexcept;
@@ -33,10 +47,21 @@ public:
     void add_entry(const std::any& value, size_t row_id);
     void remove_entry(const std::any& value, size_t row_id);
     std::set<size_t> find_range(const std::any& min_val, const std::any& max_val) const;
+    std::vector<size_t> find_range(const std::optional<IndexBound>& lower, const std::optional<IndexBound>& upper) const;
     void clear();
 
+    void attach(PersistedIndex index); ///< Диапазоны ищутся по блокам файла до первого изменения.
+    bool is_mapped() const { return persisted.attached(); }
+    void materialize(); ///< Копирует подключённый индекс в дерево.
+
+    using EntryMap = std::map<std::any, std::set<size_t>, decltype(&compare_any_order)>;
+    const EntryMap& entries() const { return index_map; } ///< Записи в порядке возрастания ключа (только без подключённого индекса).
+
 private:
-    std::map<std::any, std::set<size_t>, decltype(&compare_any_order)> index_map{ compare_any_order };
+    EntryMap index_map{ compare_any_order };
+    PersistedIndex persisted;
+
+    std::vector<size_t> persisted_rows(size_t first, size_t last) const; ///< Строки ключей [first, last) подключённого индекса.
 };
 
 
@@ -0,0 +1,272 @@
+#include "predicate.h"
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+#include <string_view>
+
+namespace {
+
+template <typename T>
+bool compare_values(const T& lhs, CompareOp op, const T& rhs) {
+    switch (op) {
+    case CompareOp::Eq: return lhs == rhs;
+    case CompareOp::Lt: return lhs < rhs;
+    case CompareOp::Le: return lhs <= rhs;
+    case CompareOp::Gt: return lhs > rhs;
+    case CompareOp::Ge: return lhs >= rhs;
+    }
+    return false;
+}
+
+// Проход по диапазону строк одного столбца; оператор выбирается один раз вне цикла.
+template <typename T, typename Getter, typename Sink>
+void scan_compare(const Column& column, CompareOp op, const T& value, Getter get, Sink&& sink, size_t begin, size_t end) {
+    auto run = [&](auto cmp) {
+        for (size_t row = begin; row < end; ++row) {
+            if (!column.is_null(row) && cmp(get(row), value)) {
+                sink(row);
+            }
+        }
+    };
+    switch (op) {
+    case CompareOp::Eq: run([](const auto& a, const auto& b) { return a == b; }); break;
+    case CompareOp::Lt: run([](const auto& a, const auto& b) { return a < b; }); break;
+    case CompareOp::Le: run([](const auto& a, const auto& b) { return a <= b; }); break;
+    case CompareOp::Gt: run([](const auto& a, const auto& b) { return a > b; }); break;
+    case CompareOp::Ge: run([](const auto& a, const auto& b) { return a >= b; }); break;
+    }
+}
+
+// Имя типа столбца, как в схеме таблицы
+const char* type_name(ColumnType type) {
+    switch (type) {
+    case ColumnType::Int32: return "int32";
+    case ColumnType::String: return "string";
+    case ColumnType::Bool: return "bool";
+    }
+    return "unknown";
+}
+
+} // namespace
+
+Predicate Predicate::compile(const Condition& condition,
+    const std::vector<std::string>& column_names,
+    const std::vector<Column>& columns) {
+    Predicate predicate;
+    predicate.nodes.reserve(condition.get_nodes().size());
+    predicate.root = predicate.bind_node(condition, condition.get_root(), column_names, columns);
+    return predicate;
+}
+
+Predicate Predicate::compile(const std::string& condition,
+    const std::vector<std::string>& column_names,
+    const std::vector<Column>& columns) {
+    return compile(Condition::parse(condition), column_names, columns);
+}
+
+size_t Predicate::add_node(Node node) {
+    nodes.push_back(std::move(node));
+    return nodes.size() - 1;
+}
+
+// Узел условия с именем столбца становится узлом с номером столбца и константой его типа
+size_t Predicate::bind_node(const Condition& condition, size_t index,
+    const std::vector<std::string>& column_names,
+    const std::vector<Column>& columns) {
+    const Condition::Node& source = condition.get_nodes()[index];
+    Node node;
+    switch (source.kind) {
+    case Condition::NodeKind::Constant:
+        node.kind = NodeKind::Constant;
+        node.bool_value = source.bool_value;
+        return add_node(std::move(node));
+    case Condition::NodeKind::And:
+    case Condition::NodeKind::Or:
+        node.kind = source.kind == Condition::NodeKind::And ? NodeKind::And : NodeKind::Or;
+        node.left = bind_node(condition, source.left, column_names, columns);
+        node.right = bind_node(condition, source.right, column_names, columns);
+        return add_node(std::move(node));
+    case Condition::NodeKind::Compare:
+        break;
+    }
+
+    const std::string& col_name = source.column;
+    auto it = std::find(column_names.begin(), column_names.end(), col_name);
+    if (it == column_names.end()) {
+        throw std::runtime_error("Column '" + col_name + "' not found.");
+    }
+
+    node.kind = NodeKind::Compare;
+    node.op = source.op;
+    node.column = std::distance(column_names.begin(), it);
+    node.type = columns[node.column].type();
+
+    switch (source.value_kind) {
+    case Condition::ValueKind::Null:
+        // Сравнение с NULL
+        if (node.op != CompareOp::Eq) {
+            throw std::runtime_error("Unsupported operator for NULL comparison in: " + condition.text());
+        }
+        node.kind = NodeKind::IsNull;
+        break;
+    case Condition::ValueKind::Bool:
+        if (node.type != ColumnType::Bool) {
+            throw std::runtime_error("Type mismatch for column '" + col_name + "': got bool, column is " +
+                type_name(node.type) + ".");
+        }
+        if (node.op != CompareOp::Eq) {
+            throw std::runtime_error("Unsupported operator for bool column '" + col_name + "'.");
+        }
+        node.bool_value = source.bool_value;
+        break;
+    case Condition::ValueKind::String:
+        if (node.type != ColumnType::String) {
+            throw std::runtime_error("Type mismatch for column '" + col_name + "': got string, column is " +
+                type_name(node.type) + ".");
+        }
+        node.string_value = source.string_value;
+        break;
+    case Condition::ValueKind::Int:
+        if (node.type != ColumnType::Int32) {
+            throw std::runtime_error("Type mismatch for column '" + col_name + "': got int, column is " +
+                type_name(node.type) + ".");
+        }
+        node.int_value = source.int_value;
+        break;
+    case Condition::ValueKind::Parameter:
+        throw std::runtime_error("Parameter " + std::to_string(source.parameter + 1) + " is not bound.");
+    }
+    return add_node(std::move(node));
+}
+
+bool Predicate::is_always_true() const {
+    return !nodes.empty() && nodes[root].kind == NodeKind::Constant && nodes[root].bool_value;
+}
+
+bool Predicate::matches(const std::vector<Column>& columns, size_t row) const {
+    return matches_node(root, columns, row);
+}
+
+bool Predicate::matches_node(size_t index, const std::vector<Column>& columns, size_t row) const {
+    const Node& node = nodes[index];
+    switch (node.kind) {
+    case NodeKind::Constant:
+        return node.bool_value;
+    case NodeKind::And:
+        return matches_node(node.left, columns, row) && matches_node(node.right, columns, row);
+    case NodeKind::Or:
+        return matches_node(node.left, columns, row) || matches_node(node.right, columns, row);
+    case NodeKind::IsNull:
+        return columns[node.column].is_null(row);
+    case NodeKind::Compare: {
+        const Column& column = columns[node.column];
+        if (column.is_null(row)) {
+            return false;
+        }
+        switch (node.type) {
+        case ColumnType::Int32:
+            return compare_values(column.get_int(row), node.op, node.int_value);
+        case ColumnType::String:
+            return compare_values(column.get_string(row), node.op, std::string_view(node.string_value));
+        case ColumnType::Bool:
+            return compare_values(column.get_bool(row), node.op, node.bool_value);
+        }
+        return false;
+    }
+    }
+    return false;
+}
+
+std::vector<size_t> Predicate::select(const std::vector<Column>& columns, size_t begin, size_t end) const {
+    std::vector<size_t> out;
+    select_node(root, columns, begin, end, out);
+    return out;
+}
+
+void Predicate::select_node(size_t index, const std::vector<Column>& columns, size_t begin, size_t end, std::vector<size_t>& out) const {
+    const Node& node = nodes[index];
+    switch (node.kind) {
+    case NodeKind::Constant:
+        if (node.bool_value) {
+            out.reserve(out.size() + (end - begin));
+            for (size_t row = begin; row < end; ++row) {
+                out.push_back(row);
+            }
+        }
+        return;
+    case NodeKind::And:
+        // Правая часть проверяется только на строках, прошедших левую
+        select_node(node.left, columns, begin, end, out);
+        filter_node(node.right, columns, out);
+        return;
+    case NodeKind::Or: {
+        std::vector<size_t> left_rows, right_rows;
+        select_node(node.left, columns, begin, end, left_rows);
+        select_node(node.right, columns, begin, end, right_rows);
+        std::set_union(left_rows.begin(), left_rows.end(), right_rows.begin(), right_rows.end(), std::back_inserter(out));
+        return;
+    }
+    case NodeKind::IsNull: {
+        const Column& column = columns[node.column];
+        for (size_t row = begin; row < end; ++row) {
+            if (column.is_null(row)) {
+                out.push_back(row);
+            }
+        }
+        return;
+    }
+    case NodeKind::Compare: {
+        const Column& column = columns[node.column];
+        auto sink = [&out](size_t row) { out.push_back(row); };
+        switch (node.type) {
+        case ColumnType::Int32:
+            scan_compare(column, node.op, node.int_value, [&column](size_t row) { return column.get_int(row); }, sink, begin, end);
+            break;
+        case ColumnType::String:
+            scan_compare(column, node.op, std::string_view(node.string_value), [&column](size_t row) { return column.get_string(row); }, sink, begin, end);
+            break;
+        case ColumnType::Bool:
+            scan_compare(column, node.op, node.bool_value, [&column](size_t row) { return column.get_bool(row); }, sink, begin, end);
+            break;
+        }
+        return;
+    }
+    }
+}
+
+void Predicate::filter(const std::vector<Column>& columns, std::vector<size_t>& rows) const {
+    filter_node(root, columns, rows);
+}
+
+void Predicate::filter_node(size_t index, const std::vector<Column>& columns, std::vector<size_t>& rows) const {
+    const Node& node = nodes[index];
+    switch (node.kind) {
+    case NodeKind::Constant:
+        if (!node.bool_value) {
+            rows.clear();
+        }
+        return;
+    case NodeKind::And:
+        filter_node(node.left, columns, rows);
+        filter_node(node.right, columns, rows);
+        return;
+    case NodeKind::Or: {
+        // Строки, не прошедшие левую часть, проверяются правой
+        std::vector<size_t> left_rows = rows;
+        filter_node(node.left, columns, left_rows);
+        std::vector<size_t> rest;
+        std::set_difference(rows.begin(), rows.end(), left_rows.begin(), left_rows.end(), std::back_inserter(rest));
+        filter_node(node.right, columns, rest);
+        rows.clear();
+        std::merge(left_rows.begin(), left_rows.end(), rest.begin(), rest.end(), std::back_inserter(rows));
+        return;
+    }
+    default: {
+        auto new_end = std::remove_if(rows.begin(), rows.end(), [&](size_t row) {
+            return !matches_node(index, columns, row);
+            });
+        rows.erase(new_end, rows.end());
+        return;
+    }
+    }
+}
@@ -0,0 +1,81 @@
+#pragma once
+#ifndef PREDICATE_H
+#define PREDICATE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "column.h"
+#include "condition.h"
+
+/**
+ * @class Predicate
+ * Условие WHERE, скомпилированное один раз в дерево узлов.
+ * Узлы ссылаются на столбцы по номеру и хранят типизированные константы,
+ * поэтому вычисление идёт прямо по колоночному хранилищу без выделения памяти на строку.
+ */
+class Predicate {
+public:
+    enum class NodeKind {
+        Constant, ///< true / false
+        Compare,  ///< столбец <op> константа
+        IsNull,   ///< столбец = NULL
+        And,
+        Or
+    };
+
+    struct Node {
+        NodeKind kind = NodeKind::Constant;
+        CompareOp op = CompareOp::Eq;
+        size_t column = 0;              ///< Номер столбца в таблице.
+        ColumnType type = ColumnType::Int32;
+        int32_t int_value = 0;
+        bool bool_value = false;        ///< Также значение узла Constant.
+        std::string string_value;
+        size_t left = 0;                ///< Дочерние узлы And / Or.
+        size_t right = 0;
+    };
+
+    /**
+     * @brief Привязывает разобранное условие к таблице с заданными столбцами.
+     * @param condition Условие без параметров (Condition::parse, Condition::bind).
+     * @param column_names Имена столбцов таблицы.
+     * @param columns Хранилище столбцов (используются только их типы).
+     */
+    static Predicate compile(const Condition& condition,
+        const std::vector<std::string>& column_names,
+        const std::vector<Column>& columns);
+    // То же для текста условия ("id >= 2 AND (name = 'Bob' OR is_admin = true)").
+    static Predicate compile(const std::string& condition,
+        const std::vector<std::string>& column_names,
+        const std::vector<Column>& columns);
+
+    // Проверяет одну строку.
+    bool matches(const std::vector<Column>& columns, size_t row) const;
+
+    // Возвращает номера строк из [begin, end), удовлетворяющих условию, по возрастанию.
+    std::vector<size_t> select(const std::vector<Column>& columns, size_t begin, size_t end) const;
+
+    // Оставляет в rows (упорядоченных по возрастанию) только строки, удовлетворяющие условию.
+    void filter(const std::vector<Column>& columns, std::vector<size_t>& rows) const;
+
+    bool is_always_true() const;
+
+    const std::vector<Node>& get_nodes() const { return nodes; }
+    size_t get_root() const { return root; }
+
+private:
+    std::vector<Node> nodes;
+    size_t root = 0;
+
+    size_t bind_node(const Condition& condition, size_t index,
+        const std::vector<std::string>& column_names,
+        const std::vector<Column>& columns);
+    size_t add_node(Node node);
+
+    bool matches_node(size_t node, const std::vector<Column>& columns, size_t row) const;
+    void select_node(size_t node, const std::vector<Column>& columns, size_t begin, size_t end, std::vector<size_t>& out) const;
+    void filter_node(size_t node, const std::vector<Column>& columns, std::vector<size_t>& rows) const;
+};
+
+#endif // PREDICATE_H
@@ -0,0 +1,50 @@
+#include "prepared_statement.h"
+#include "database.h"
+#include <algorithm>
+#include <stdexcept>
+
+PreparedStatement::PreparedStatement(Database& db, std::shared_ptr<const QueryProcessor::Statement> statement)
+    : db(&db), statement(std::move(statement)) {
+    parameters.resize(this->statement->parameter_count);
+    bound.resize(this->statement->parameter_count, false);
+}
+
+PreparedStatement& PreparedStatement::bind(size_t index, int value) {
+    return set(index, value);
+}
+
+PreparedStatement& PreparedStatement::bind(size_t index, bool value) {
+    return set(index, value);
+}
+
+PreparedStatement& PreparedStatement::bind(size_t index, const std::string& value) {
+    return set(index, value);
+}
+
+PreparedStatement& PreparedStatement::bind_null(size_t index) {
+    return set(index, std::any());
+}
+
+PreparedStatement& PreparedStatement::set(size_t index, std::any value) {
+    if (index == 0 || index > parameters.size()) {
+        throw std::runtime_error("Parameter index out of range: " + std::to_string(index) +
+            " (statement has " + std::to_string(parameters.size()) + " parameters).");
+    }
+    parameters[index - 1] = std::move(value);
+    bound[index - 1] = true;
+    return *this;
+}
+
+void PreparedStatement::clear_bindings() {
+    std::fill(parameters.begin(), parameters.end(), std::any());
+    std::fill(bound.begin(), bound.end(), false);
+}
+
+std::string PreparedStatement::execute() {
+    for (size_t i = 0; i < bound.size(); ++i) {
+        if (!bound[i]) {
+            throw std::runtime_error("Parameter " + std::to_string(i + 1) + " is not bound.");
+        }
+    }
+    return db->execute(*statement, parameters);
+}
@@ -0,0 +1,46 @@
+#pragma once
+#ifndef PREPARED_STATEMENT_H
+#define PREPARED_STATEMENT_H
+
+#include <any>
+#include <memory>
+#include <string>
+#include <vector>
+#include "query_processor.h"
+
+class Database;
+
+/**
+ * @class PreparedStatement
+ * Запрос, разобранный один раз (Database::prepare). Значения вместо "?" задаются bind
+ * и сохраняются между выполнениями; номера параметров начинаются с 1 в порядке их появления в тексте.
+ * Привязанная строка может содержать любые символы; строковая константа в тексте запроса
+ * заканчивается на первой кавычке, удвоенная кавычка '' не поддерживается.
+ * Копии объекта разделяют разобранный запрос, но привязывают значения независимо.
+ */
+class PreparedStatement {
+public:
+    PreparedStatement(Database& db, std::shared_ptr<const QueryProcessor::Statement> statement);
+
+    size_t parameter_count() const { return statement->parameter_count; }
+
+    PreparedStatement& bind(size_t index, int value);
+    PreparedStatement& bind(size_t index, bool value);
+    PreparedStatement& bind(size_t index, const std::string& value);
+    PreparedStatement& bind(size_t index, const char* value) { return bind(index, std::string(value)); }
+    PreparedStatement& bind_null(size_t index);
+    void clear_bindings();
+
+    // Выполняет запрос так же, как Database::execute; все параметры должны быть заданы.
+    std::string execute();
+
+private:
+    Database* db;
+    std::shared_ptr<const QueryProcessor::Statement> statement;
+    std::vector<std::any> parameters;
+    std::vector<bool> bound;
+
+    PreparedStatement& set(size_t index, std::any value);
+};
+
+#endif // PREPARED_STATEMENT_H
@@ -1,291 +1,528 @@
 #include "query_processor.h"
 #include "database.h"
+#include "lexer.h"
 #include <sstream>
 #include <stdexcept>
 #include <iostream> 
 #include <algorithm>
-#include "utils.h"
 #include <string>
 
-std::string QueryProcessor::parse_and_execute(Database& db, const std::string& query) {
-    std::istringstream stream(query);
-    std::string command;
-    stream >> command;
-
-    if (command == "CREATE") {
-        std::string temp;
-        stream >> temp;
-        if (temp == "TABLE") {
-            std::string table_name;
-            stream >> table_name;
-
-            std::string schema_def;
-            std::getline(stream, schema_def, '(');
-            std::getline(stream, schema_def, ')');
-
-            std::istringstream schema_stream(schema_def);
-            std::map<std::string, std::string> schema;
-            std::string column;
-            while (std::getline(schema_stream, column, ',')) {
-                auto colon_pos = column.find(':');
-                if (colon_pos == std::string::npos)
-                    throw std::runtime_error("Syntax error in schema definition.");
-                std::string col_name = trim(column.substr(0, colon_pos));
-                std::string col_type = trim(column.substr(colon_pos + 1));
-                schema[col_name] = col_type;
-            }
-
-            db.create_table(table_name, schema);
-            std::cout << "Table created: " << table_name << std::endl;
-            return "Table " + table_name + " created.";
+namespace {
+
+using Statement = QueryProcessor::Statement;
+using Operand = QueryProcessor::Operand;
+
+// Значение столбца в INSERT / UPDATE: константа, NULL или параметр "?".
+// col_name - для сообщения об ошибке (пусто, если столбец определяется позицией значения).
+Operand parse_operand(Lexer& lexer, Statement& statement, std::string_view col_name) {
+    Operand operand;
+    const Token& token = lexer.peek();
+    switch (token.kind) {
+    case Token::Kind::Number:
+        operand.value = static_cast<int>(parse_int32(token.text));
+        break;
+    case Token::Kind::String:
+        operand.value = std::string(token.text);
+        break;
+    case Token::Kind::Question:
+        operand.parameter = statement.parameter_count++;
+        break;
+    case Token::Kind::Word:
+        if (token.text == "true" || token.text == "false") {
+            operand.value = (token.text == "true");
+            break;
         }
+        if (token.text == "NULL" || token.text == "null") {
+            break; // Пустое значение
+        }
+        [[fallthrough]];
+    default:
+        lexer.fail(col_name.empty() ? std::string("Invalid value in INSERT row")
+                                    : "Invalid value for column '" + std::string(col_name) + "'");
     }
-    else if (command == "INSERT") {
-        std::string temp, table_name, values_def;
-        stream >> temp; // TO
-        if (temp != "TO") throw std::runtime_error("Syntax error: Expected 'TO' after INSERT.");
-
-        stream >> table_name;
+    lexer.next();
+    return operand;
+}
 
-        std::getline(stream, values_def, '(');
-        std::getline(stream, values_def, ')');
-        values_def = trim(values_def);
+std::string parse_name(Lexer& lexer, const char* what) {
+    return std::string(lexer.expect(Token::Kind::Word, what).text);
+}
 
-        if (values_def.empty()) {
-            throw std::runtime_error("No values specified for INSERT.");
+// Список "столбец = значение" через запятую; повторный столбец заменяет прежнее значение.
+// col_name - уже прочитанное имя первого столбца (пусто, если не прочитано).
+void parse_assignments(Lexer& lexer, Statement& statement, std::string col_name = {}) {
+    do {
+        if (col_name.empty()) {
+            col_name = parse_name(lexer, "Expected column name");
         }
+        lexer.expect(Token::Kind::Equal, "Expected '=' after column name");
+        Operand operand = parse_operand(lexer, statement, col_name);
+        auto existing = std::find_if(statement.values.begin(), statement.values.end(),
+            [&col_name](const auto& entry) { return entry.first == col_name; });
+        if (existing != statement.values.end()) {
+            existing->second = std::move(operand);
+        }
+        else {
+            statement.values.emplace_back(std::move(col_name), std::move(operand));
+        }
+        col_name.clear();
+    } while (lexer.accept(Token::Kind::Comma));
+}
 
-        std::istringstream values_stream(values_def);
-        std::map<std::string, std::any> values;
-        std::string value;
-        while (std::getline(values_stream, value, ',')) {
-            auto equals_pos = value.find('=');
-            if (equals_pos != std::string::npos) {
-                std::string col_name = trim(value.substr(0, equals_pos));
-                std::string col_value = trim(value.substr(equals_pos + 1));
-
-                if (col_value.empty()) {
-                    throw std::runtime_error("Empty value for column: " + col_name);
-                }
-
-                if (col_value[0] == '\'') {
-                    col_value = col_value.substr(1, col_value.size() - 2);
-                    values[col_name] = col_value;
-                }
-                else if (col_value == "true" || col_value == "false") {
-                    values[col_name] = (col_value == "true");
-                }
-                else {
-                    if (!is_numeric(col_value)) {
-                        throw std::runtime_error("Invalid numeric value for column: " + col_name);
-                    }
-                    values[col_name] = std::stoi(col_value);
-                }
+// VALUES (value, ...), (value, ...), ... - значения по порядку statement.columns
+void parse_insert_rows(Lexer& lexer, Statement& statement) {
+    lexer.expect_word("VALUES", "Expected '(' or 'VALUES' after table name in INSERT");
+    do {
+        lexer.expect(Token::Kind::LeftParen, "Expected '(' before INSERT row");
+        std::vector<Operand>& row = statement.rows.emplace_back();
+        row.reserve(statement.columns.size());
+        do {
+            std::string_view col_name;
+            if (row.size() < statement.columns.size()) {
+                col_name = statement.columns[row.size()];
             }
+            row.push_back(parse_operand(lexer, statement, col_name));
+        } while (lexer.accept(Token::Kind::Comma));
+        if (!statement.columns.empty() && row.size() != statement.columns.size()) {
+            lexer.fail("Expected " + std::to_string(statement.columns.size()) + " values in INSERT row");
         }
+        lexer.expect(Token::Kind::RightParen, "Expected ')' after INSERT row");
+    } while (lexer.accept(Token::Kind::Comma));
+}
 
-        Table* table = db.get_table(table_name);
-        if (!table) throw std::runtime_error("Table not found: " + table_name);
+// Ограничение столбца после типа в CREATE TABLE; у столбца не больше одного ограничения
+void parse_constraint(Lexer& lexer, Statement& statement, const std::string& col_name) {
+    std::string constraint;
+    if (lexer.accept_word("PRIMARY")) {
+        lexer.expect_word("KEY", "Expected 'KEY' after PRIMARY");
+        constraint = "PRIMARY KEY";
+    }
+    else if (lexer.accept_word("UNIQUE")) {
+        constraint = "UNIQUE";
+    }
+    else if (lexer.accept_word("NOT")) {
+        lexer.expect_word("NULL", "Expected 'NULL' after NOT");
+        constraint = "NOT NULL";
+    }
+    else {
+        return;
+    }
+    if (lexer.peek().kind == Token::Kind::Word) {
+        lexer.fail("Only one constraint per column is supported");
+    }
+    statement.constraints[col_name] = constraint;
+}
 
-        //  ID
-        if (values.find("id") != values.end()) {
-            int id_value = std::any_cast<int>(values["id"]);
-            if (!table->is_unique("id", id_value)) {
-                throw std::runtime_error("Duplicate ID detected: " + std::to_string(id_value));
-            }
-        }
+// Поле JOIN: таблица.столбец; таблица должна совпадать с указанной в запросе
+std::string parse_join_field(Lexer& lexer, const std::string& table_name) {
+    std::string table_prefix = parse_name(lexer, "Expected table.column in JOIN condition");
+    lexer.expect(Token::Kind::Dot, "Expected '.' in JOIN field");
+    std::string column = parse_name(lexer, "Expected column name in JOIN condition");
+    if (table_prefix != table_name) {
+        throw std::runtime_error("Field does not belong to specified table in JOIN.");
+    }
+    return column;
+}
 
-        table->insert(values);
-        std::cout << "Row inserted into table: " << table_name << std::endl;
-        return "Row inserted into " + table_name + ".";
+const std::any& operand_value(const Operand& operand, const std::vector<std::any>& parameters) {
+    if (operand.parameter == QueryProcessor::kNoParameter) {
+        return operand.value;
     }
-    else if (command == "DELETE") {
-        std::string temp, table_name, condition;
-        stream >> temp >> table_name >> temp;
-        if (temp != "WHERE") throw std::runtime_error("Syntax error: Expected 'WHERE'.");
+    if (operand.parameter >= parameters.size()) {
+        throw std::runtime_error("Parameter " + std::to_string(operand.parameter + 1) + " is not bound.");
+    }
+    return parameters[operand.parameter];
+}
 
-        std::getline(stream, condition);
-        condition = trim(condition);
+// Условие запроса с подставленными параметрами; без параметров копия не создаётся
+const Condition& bound_condition(const Statement& statement, const std::vector<std::any>& parameters, Condition& storage) {
+    if (statement.parameter_count == 0) {
+        return statement.condition;
+    }
+    storage = statement.condition.bind(parameters);
+    return storage;
+}
 
-        if (condition.empty()) {
-            throw std::runtime_error("Missing or empty condition in DELETE query.");
-        }
+} // namespace
 
-        Table* table = db.get_table(table_name);
-        if (!table) throw std::runtime_error("Table not found: " + table_name);
+bool QueryProcessor::is_transaction_control(const std::string& query) {
+    Lexer lexer(query);
+    const Token& command = lexer.peek();
+    return command.is_word("BEGIN") || command.is_word("COMMIT") || command.is_word("ROLLBACK") ||
+        command.is_word("SAVEPOINT") || command.is_word("RELEASE");
+}
 
-        table->remove(condition);
-        std::cout << "Rows deleted from table: " << table_name << std::endl;
-        return "Rows deleted from " + table_name + ".";
+bool QueryProcessor::is_transaction_control(const Statement& statement) {
+    switch (statement.kind) {
+    case Statement::Kind::Begin:
+    case Statement::Kind::Commit:
+    case Statement::Kind::Rollback:
+    case Statement::Kind::RollbackTo:
+    case Statement::Kind::Savepoint:
+    case Statement::Kind::Release:
+        return true;
+    default:
+        return false;
     }
-    else if (query.find("JOIN") != std::string::npos) {
-        if (query.find("JOIN") != std::string::npos) {
-            size_t join_pos = query.find("JOIN");
-            size_t on_pos = query.find("ON");
-            std::string table1_name = trim(query.substr(14, join_pos - 14)); // FROM table1
-            std::string table2_name = trim(query.substr(join_pos + 5, on_pos - join_pos - 5)); // JOIN table2
-            std::string condition = trim(query.substr(on_pos + 3)); // ON table1.col1 = table2.col2
-
-            auto delimiter_pos = condition.find('=');
-            std::string table1_field = trim(condition.substr(0, delimiter_pos - 1));
-            std::string table2_field = trim(condition.substr(delimiter_pos + 2));
-
-            auto [table1_prefix, column1_name] = parse_field(table1_field);
-            auto [table2_prefix, column2_name] = parse_field(table2_field);
-
-            if (table1_prefix != table1_name || table2_prefix != table2_name) {
-                throw std::runtime_error("Field does not belong to specified table in JOIN.");
-            }
-
-            Table* table1 = db.get_table(table1_name);
-            Table* table2 = db.get_table(table2_name);
+}
 
-            if (!table1 || !table2) {
-                throw std::runtime_error("One or both tables not found for JOIN.");
+QueryProcessor::Statement QueryProcessor::parse(const std::string& query) {
+    Statement statement;
+    Lexer lexer(query);
+
+    if (lexer.accept_word("CREATE")) {
+        if (lexer.accept_word("TABLE")) {
+            // CREATE TABLE name (column:type [PRIMARY KEY | UNIQUE | NOT NULL], ...)
+            statement.kind = Statement::Kind::CreateTable;
+            statement.table = parse_name(lexer, "Expected table name after CREATE TABLE");
+            lexer.expect(Token::Kind::LeftParen, "Expected '(' before schema definition");
+            if (!lexer.accept(Token::Kind::RightParen)) {
+                do {
+                    std::string col_name = parse_name(lexer, "Expected column name in schema definition");
+                    lexer.expect(Token::Kind::Colon, "Expected ':' after column name in schema definition");
+                    statement.schema[col_name] = parse_name(lexer, "Expected column type in schema definition");
+                    parse_constraint(lexer, statement, col_name);
+                } while (lexer.accept(Token::Kind::Comma));
+                lexer.expect(Token::Kind::RightParen, "Expected ')' after schema definition");
             }
-
-            Table result = table1->join(*table2, column1_name, column2_name);
-
-            std::ostringstream oss;
-            for (const auto& row : result.select("true")) {
-                for (const auto& [key, value] : row) {
-                    if (value.type() == typeid(std::string)) {
-                        oss << key << ": " << std::any_cast<std::string>(value) << ", ";
-                    }
-                    else if (value.type() == typeid(int)) {
-                        oss << key << ": " << std::any_cast<int>(value) << ", ";
-                    }
-                    else if (value.type() == typeid(bool)) {
-                        oss << key << ": " << (std::any_cast<bool>(value) ? "true" : "false") << ", ";
-                    }
+        }
+        else if (lexer.peek().is_word("INDEX") || lexer.peek().is_word("ORDERED")) {
+            // CREATE INDEX ON table (column) - хеш-индекс для равенства
+            // CREATE ORDERED INDEX ON table (column) - упорядоченный индекс для диапазонов
+            statement.kind = Statement::Kind::CreateIndex;
+            statement.ordered = lexer.accept_word("ORDERED");
+            lexer.expect_word("INDEX", "Expected 'INDEX' after ORDERED");
+            lexer.expect_word("ON", "Expected 'ON' in CREATE INDEX");
+            statement.table = parse_name(lexer, "Expected table name in CREATE INDEX");
+            lexer.expect(Token::Kind::LeftParen, "Expected '(' before index column");
+            statement.column = parse_name(lexer, "Missing column name in CREATE INDEX");
+            lexer.expect(Token::Kind::RightParen, "Expected ')' after index column");
+        }
+        else {
+            return statement; // Неизвестная команда
+        }
+    }
+    else if (lexer.accept_word("INSERT")) {
+        // INSERT TO table (column=value, ...)
+        // INSERT TO table [(column, ...)] VALUES (value, ...), (value, ...), ... - без списка по порядку столбцов таблицы
+        lexer.expect_word("TO", "Expected 'TO' after INSERT");
+        statement.kind = Statement::Kind::Insert;
+        statement.table = parse_name(lexer, "Expected table name after INSERT TO");
+        if (lexer.accept(Token::Kind::LeftParen)) {
+            if (lexer.peek().kind == Token::Kind::RightParen) {
+                throw std::runtime_error("No values specified for INSERT.");
+            }
+            std::string col_name = parse_name(lexer, "Expected column name in INSERT");
+            if (lexer.peek().kind == Token::Kind::Equal) {
+                parse_assignments(lexer, statement, std::move(col_name));
+                lexer.expect(Token::Kind::RightParen, "Expected ')' after INSERT values");
+                std::vector<Operand>& row = statement.rows.emplace_back();
+                for (auto& [name, operand] : statement.values) {
+                    statement.columns.push_back(std::move(name));
+                    row.push_back(std::move(operand));
                 }
-                oss << "\n";
+                statement.values.clear();
+            }
+            else {
+                statement.columns.push_back(std::move(col_name));
+                while (lexer.accept(Token::Kind::Comma)) {
+                    statement.columns.push_back(parse_name(lexer, "Expected column name in INSERT"));
+                }
+                lexer.expect(Token::Kind::RightParen, "Expected ')' after INSERT column list");
+                parse_insert_rows(lexer, statement);
             }
-
-            return oss.str();
         }
-
-        return "Unknown command.";
+        else {
+            parse_insert_rows(lexer, statement);
+        }
     }
-    else if (command == "UPDATE") {
-        std::string table_name, temp, updates_str, condition;
-
-        //   
-        stream >> table_name >> temp;
-        if (temp != "SET") {
-            throw std::runtime_error("Syntax error: Expected 'SET' after table name in UPDATE query.");
+    else if (lexer.accept_word("DELETE")) {
+        // DELETE FROM table WHERE condition
+        lexer.expect_word("FROM", "Expected 'FROM' after DELETE");
+        statement.kind = Statement::Kind::Delete;
+        statement.table = parse_name(lexer, "Expected table name in DELETE");
+        lexer.expect_word("WHERE", "Expected 'WHERE'");
+        if (lexer.peek().kind == Token::Kind::End) {
+            throw std::runtime_error("Missing or empty condition in DELETE query.");
         }
-
-        //       "WHERE"
-        std::getline(stream, updates_str, 'W');
-        updates_str = trim(updates_str); //   
-
-        if (updates_str.empty()) {
+        statement.condition = Condition::parse(lexer, statement.parameter_count);
+    }
+    else if (lexer.accept_word("UPDATE")) {
+        // UPDATE table SET column=value, ... WHERE condition
+        statement.kind = Statement::Kind::Update;
+        statement.table = parse_name(lexer, "Expected table name after UPDATE");
+        lexer.expect_word("SET", "Expected 'SET' after table name in UPDATE query");
+        if (lexer.peek().is_word("WHERE") || lexer.peek().kind == Token::Kind::End) {
             throw std::runtime_error("Missing update values in UPDATE query.");
         }
-
-        //    "WHERE"
-        std::getline(stream, condition);
-        condition = "W" + condition; //  'W',    
-        condition = trim(condition);
-        if (condition.substr(0, 6) == "WHERE ") {
-            condition = condition.substr(6); //  "WHERE "   
-        }
-
-        if (condition.empty()) {
+        parse_assignments(lexer, statement); // Параметры SET нумеруются раньше параметров условия
+        lexer.expect_word("WHERE", "Expected 'WHERE' in UPDATE query");
+        if (lexer.peek().kind == Token::Kind::End) {
             throw std::runtime_error("Empty condition in UPDATE query.");
         }
-
-        //   
-        std::map<std::string, std::any> updates;
-        std::istringstream updates_stream(updates_str);
-        std::string update;
-        while (std::getline(updates_stream, update, ',')) {
-            auto equals_pos = update.find('=');
-            if (equals_pos == std::string::npos) {
-                throw std::runtime_error("Syntax error in UPDATE values: " + update);
+        statement.condition = Condition::parse(lexer, statement.parameter_count);
+    }
+    else if (lexer.accept_word("SELECT")) {
+        // SELECT columns FROM table [WHERE condition]
+        // SELECT columns FROM table1 JOIN table2 ON table1.column = table2.column
+        if (!lexer.accept(Token::Kind::Star)) {
+            do {
+                parse_name(lexer, "Expected column list after SELECT"); // Выбираются все столбцы
+            } while (lexer.accept(Token::Kind::Comma));
+        }
+        lexer.expect_word("FROM", "Expected 'FROM' in SELECT");
+        statement.table = parse_name(lexer, "Expected table name after FROM");
+        if (lexer.accept_word("JOIN")) {
+            statement.kind = Statement::Kind::Join;
+            statement.other_table = parse_name(lexer, "Expected table name after JOIN");
+            lexer.expect_word("ON", "Expected 'ON' in JOIN");
+            statement.column = parse_join_field(lexer, statement.table);
+            lexer.expect(Token::Kind::Equal, "Expected '=' in JOIN condition");
+            statement.other_column = parse_join_field(lexer, statement.other_table);
+        }
+        else {
+            statement.kind = Statement::Kind::Select;
+            if (lexer.accept_word("WHERE")) {
+                if (lexer.peek().kind == Token::Kind::End) {
+                    throw std::runtime_error("Missing or empty condition in SELECT query.");
+                }
+                statement.condition = Condition::parse(lexer, statement.parameter_count);
             }
+            // Без WHERE выбираются все строки (условие true по умолчанию)
+        }
+    }
+    else if (lexer.accept_word("BEGIN")) {
+        statement.kind = Statement::Kind::Begin;
+    }
+    else if (lexer.accept_word("COMMIT")) {
+        statement.kind = Statement::Kind::Commit;
+    }
+    else if (lexer.accept_word("ROLLBACK")) {
+        // ROLLBACK TO [SAVEPOINT] name - откат до точки сохранения без завершения транзакции
+        if (lexer.peek().kind == Token::Kind::End) {
+            statement.kind = Statement::Kind::Rollback;
+        }
+        else {
+            lexer.expect_word("TO", "Expected 'TO' after ROLLBACK");
+            lexer.accept_word("SAVEPOINT");
+            statement.kind = Statement::Kind::RollbackTo;
+            statement.name = parse_name(lexer, "Missing savepoint name in ROLLBACK TO");
+        }
+    }
+    else if (lexer.accept_word("SAVEPOINT")) {
+        statement.kind = Statement::Kind::Savepoint;
+        statement.name = parse_name(lexer, "Missing savepoint name");
+    }
+    else if (lexer.accept_word("RELEASE")) {
+        lexer.accept_word("SAVEPOINT");
+        statement.kind = Statement::Kind::Release;
+        statement.name = parse_name(lexer, "Missing savepoint name in RELEASE");
+    }
+    else {
+        return statement; // Неизвестная команда
+    }
 
-            std::string col_name = trim(update.substr(0, equals_pos));
-            std::string col_value = trim(update.substr(equals_pos + 1));
+    if (lexer.peek().kind != Token::Kind::End) {
+        lexer.fail("Unexpected token at end of query");
+    }
+    return statement;
+}
 
-            if (col_name.empty()) {
-                throw std::runtime_error("Empty column name in UPDATE values.");
+std::string QueryProcessor::execute(Database& db, const Statement& statement, const std::vector<std::any>& parameters) {
+    Transaction* txn = db.current_transaction(); // Снимок и набор изменений запроса
+
+    switch (statement.kind) {
+    case Statement::Kind::CreateTable:
+        db.create_table(statement.table, statement.schema, statement.constraints);
+        std::cout << "Table created: " << statement.table << std::endl;
+        return "Table " + statement.table + " created.";
+
+    case Statement::Kind::CreateIndex:
+        db.create_index(statement.table, statement.column, statement.ordered);
+        return "Index on " + statement.table + "(" + statement.column + ") created.";
+
+    case Statement::Kind::Insert: {
+        std::vector<std::vector<std::any>> rows;
+        rows.reserve(statement.rows.size());
+        for (const auto& operands : statement.rows) {
+            std::vector<std::any>& row = rows.emplace_back();
+            row.reserve(operands.size());
+            for (const auto& operand : operands) {
+                row.push_back(operand_value(operand, parameters)); // Пустой std::any - NULL
             }
+        }
 
-            //   
-            if (col_value == "NULL" || col_value == "null") {
-                updates[col_name] = std::any(); //    
-            }
-            else if (col_value[0] == '\'' && col_value.back() == '\'') {
-                col_value = col_value.substr(1, col_value.size() - 2); //  
-                updates[col_name] = col_value; //  
-            }
-            else if (col_value == "true" || col_value == "false") {
-                updates[col_name] = (col_value == "true"); //  
-            }
-            else {
-                if (!is_numeric(col_value)) {
-                    throw std::runtime_error("Invalid numeric value in UPDATE for column: " + col_name);
+        // Проверка ограничений (UNIQUE / PRIMARY KEY - по хеш-индексу) и вставка под одной блокировкой записи таблицы
+        std::unique_lock<std::shared_mutex> lock;
+        Table* table = db.get_table(statement.table, lock);
+        if (!table) throw std::runtime_error("Table not found: " + statement.table);
+        const std::vector<std::string>& columns = statement.columns.empty() ? table->column_names() : statement.columns;
+
+        // Уникальность ID; столбец id с ограничением UNIQUE / PRIMARY KEY проверяет insert_batch
+        auto id_column = std::find(columns.begin(), columns.end(), "id");
+        if (id_column != columns.end() && !table->is_unique_column("id")) {
+            size_t id_position = static_cast<size_t>(id_column - columns.begin());
+            std::vector<std::any> ids;
+            ids.reserve(rows.size());
+            for (const auto& row : rows) {
+                if (id_position < row.size()) {
+                    ids.push_back(row[id_position]);
                 }
-                updates[col_name] = std::stoi(col_value); //  
+            }
+            size_t duplicate = table->find_duplicate("id", ids, txn);
+            if (duplicate != Table::kNoDuplicate) {
+                const std::any& id = ids[duplicate];
+                throw std::runtime_error("Duplicate ID detected: " + (id.type() == typeid(int) ? std::to_string(std::any_cast<int>(id)) :
+                    id.type() == typeid(bool) ? std::string(std::any_cast<bool>(id) ? "true" : "false") : std::any_cast<const std::string&>(id)));
             }
         }
 
-        //  
-        Table* table = db.get_table(table_name);
-        if (!table) {
-            throw std::runtime_error("Table not found: " + table_name);
+        table->insert_batch(columns, rows, txn);
+        if (rows.size() == 1) {
+            std::cout << "Row inserted into table: " << statement.table << std::endl;
+            return "Row inserted into " + statement.table + ".";
         }
+        std::cout << rows.size() << " rows inserted into table: " << statement.table << std::endl;
+        return std::to_string(rows.size()) + " rows inserted into " + statement.table + ".";
+    }
 
-        //  
-        table->update(condition, updates);
+    case Statement::Kind::Delete: {
+        Condition storage;
+        const Condition& condition = bound_condition(statement, parameters, storage);
+        std::unique_lock<std::shared_mutex> lock;
+        Table* table = db.get_table(statement.table, lock);
+        if (!table) throw std::runtime_error("Table not found: " + statement.table);
 
-        std::cout << "Rows updated in table: " << table_name << "\n";
-        return "Rows updated in " + table_name + ".";
-        }
-    else if (command == "SELECT") {
-        std::string columns, temp, table_name, condition;
-        stream >> columns >> temp >> table_name;
-
-        //   WHERE   
-        if (stream >> temp && temp == "WHERE") {
-            std::getline(stream, condition);
-            condition = trim(condition); //   
-        }
-        else {
-            condition = "true"; //  WHERE ,   
-        }
+        table->remove(condition, txn);
+        std::cout << "Rows deleted from table: " << statement.table << std::endl;
+        return "Rows deleted from " + statement.table + ".";
+    }
 
-        if (condition.empty()) {
-            throw std::runtime_error("Missing or empty condition in SELECT query.");
+    case Statement::Kind::Begin:
+        db.begin_transaction();
+        return "Transaction started.";
+
+    case Statement::Kind::Commit:
+        db.commit_transaction();
+        return "Transaction committed.";
+
+    case Statement::Kind::RollbackTo:
+        db.rollback_to_savepoint(statement.name);
+        return "Rolled back to savepoint " + statement.name + ".";
+
+    case Statement::Kind::Rollback:
+        db.rollback_transaction();
+        return "Transaction rolled back.";
+
+    case Statement::Kind::Savepoint:
+        db.savepoint(statement.name);
+        return "Savepoint " + statement.name + " created.";
+
+    case Statement::Kind::Release:
+        db.release_savepoint(statement.name);
+        return "Savepoint " + statement.name + " released.";
+
+    case Statement::Kind::Join: {
+        const Table* table1 = db.get_table_for_read(statement.table);
+        const Table* table2 = db.get_table_for_read(statement.other_table);
+
+        if (!table1 || !table2) {
+            throw std::runtime_error("One or both tables not found for JOIN.");
         }
 
-        Table* table = db.get_table(table_name);
-        if (!table) throw std::runtime_error("Table not found: " + table_name);
+        // Блокировки чтения берутся по возрастанию адреса, как блокировки при фиксации
+        bool first_is_table1 = std::less<const Table*>()(table1, table2);
+        std::shared_lock<std::shared_mutex> first_lock((first_is_table1 ? table1 : table2)->mutex());
+        std::shared_lock<std::shared_mutex> second_lock;
+        if (table1 != table2) {
+            second_lock = std::shared_lock<std::shared_mutex>((first_is_table1 ? table2 : table1)->mutex());
+        }
 
-        auto rows = table->select(condition);
-        std::ostringstream result;
+        Table result = table1->join(*table2, statement.column, statement.other_column, txn);
+        if (second_lock) {
+            second_lock.unlock();
+        }
+        first_lock.unlock(); // Результат соединения - отдельная таблица
 
-        //   
-        for (const auto& row : rows) {
-            for (const auto& [col_name, value] : row) {
+        std::ostringstream oss;
+        for (const auto& row : result.select("true")) {
+            for (const auto& [key, value] : row) {
                 if (value.type() == typeid(std::string)) {
-                    result << col_name << ": " << std::any_cast<std::string>(value) << ", ";
+                    oss << key << ": " << std::any_cast<std::string>(value) << ", ";
                 }
                 else if (value.type() == typeid(int)) {
-                    result << col_name << ": " << std::any_cast<int>(value) << ", ";
+                    oss << key << ": " << std::any_cast<int>(value) << ", ";
                 }
                 else if (value.type() == typeid(bool)) {
-                    result << col_name << ": " << (std::any_cast<bool>(value) ? "true" : "false") << ", ";
+                    oss << key << ": " << (std::any_cast<bool>(value) ? "true" : "false") << ", ";
+                }
+            }
+            oss << "\n";
+        }
+
+        return oss.str();
+    }
+
+    case Statement::Kind::Update: {
+        std::map<std::string, std::any> updates;
+        for (const auto& [col_name, operand] : statement.values) {
+            updates[col_name] = operand_value(operand, parameters);
+        }
+        Condition storage;
+        const Condition& condition = bound_condition(statement, parameters, storage);
+
+        // Получение таблицы
+        std::unique_lock<std::shared_mutex> lock;
+        Table* table = db.get_table(statement.table, lock);
+        if (!table) {
+            throw std::runtime_error("Table not found: " + statement.table);
+        }
+
+        // Выполнение обновления
+        table->update(condition, updates, txn);
+
+        std::cout << "Rows updated in table: " << statement.table << "\n";
+        return "Rows updated in " + statement.table + ".";
+    }
+
+    case Statement::Kind::Select: {
+        Condition storage;
+        const Condition& condition = bound_condition(statement, parameters, storage);
+        std::shared_lock<std::shared_mutex> lock;
+        const Table* table = db.get_table_for_read(statement.table, lock);
+        if (!table) throw std::runtime_error("Table not found: " + statement.table);
+
+        // Строки форматируются прямо из хранилища таблицы, без промежуточных копий значений
+        Cursor cursor = table->scan(condition, txn);
+        std::ostringstream result;
+        while (cursor.next()) {
+            RowView row = cursor.row();
+            for (size_t column = 0; column < row.column_count(); ++column) {
+                if (row.is_null(column)) {
+                    continue;
                 }
+                result << row.column_name(column) << ": ";
+                switch (row.column_type(column)) {
+                case ColumnType::Int32:
+                    result << row.get_int(column);
+                    break;
+                case ColumnType::String:
+                    result << row.get_string(column);
+                    break;
+                case ColumnType::Bool:
+                    result << (row.get_bool(column) ? "true" : "false");
+                    break;
+                }
+                result << ", ";
             }
             result << "\n";
         }
         return result.str();
     }
 
-
+    case Statement::Kind::Unknown:
+        break;
+    }
 
     return "Unknown command.";
 }
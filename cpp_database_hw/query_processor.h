@@ -1,9 +1,70 @@
 #pragma once
+#include <any>
+#include <map>
 #include <string>
+#include <utility>
+#include <vector>
+#include "condition.h"
 
-class Database; //  
+class Database; // Предварительное объявление
 
+/**
+ * @class QueryProcessor
+ * Запрос сначала разбирается в Statement, затем выполняется.
+ * Разбор - рекурсивный спуск по лексемам Lexer, без копирования текста запроса.
+ * Подготовленный запрос (Database::prepare) разбирается один раз, а при каждом выполнении
+ * в него подставляются только значения параметров "?".
+ */
 class QueryProcessor {
 public:
-    static std::string parse_and_execute(Database& db, const std::string& query);
+    static constexpr size_t kNoParameter = static_cast<size_t>(-1);
+
+    // Значение в запросе: константа или параметр
+    struct Operand {
+        std::any value;
+        size_t parameter = kNoParameter; ///< Номер параметра (с нуля) или kNoParameter для константы.
+    };
+
+    // Разобранный запрос
+    struct Statement {
+        enum class Kind {
+            Unknown,
+            CreateTable,
+            CreateIndex,
+            Insert,
+            Delete,
+            Update,
+            Select,
+            Join,
+            Begin,
+            Commit,
+            Rollback,
+            RollbackTo,
+            Savepoint,
+            Release
+        };
+        Kind kind = Kind::Unknown;
+        std::string table;
+        std::map<std::string, std::string> schema;           ///< CREATE TABLE
+        std::map<std::string, std::string> constraints;      ///< CREATE TABLE: столбец -> "PRIMARY KEY", "UNIQUE", "NOT NULL"
+        std::string column;                                  ///< CREATE INDEX; JOIN - столбец table
+        bool ordered = false;                                ///< CREATE ORDERED INDEX
+        std::vector<std::pair<std::string, Operand>> values; ///< UPDATE ... SET
+        std::vector<std::string> columns;                    ///< INSERT: столбцы значений rows; пусто - все столбцы таблицы
+        std::vector<std::vector<Operand>> rows;              ///< INSERT: строки значений
+        Condition condition;                                 ///< DELETE, UPDATE, SELECT
+        std::string other_table;  ///< JOIN
+        std::string other_column; ///< JOIN
+        std::string name;         ///< Точка сохранения
+        size_t parameter_count = 0;
+    };
+
+    static Statement parse(const std::string& query);
+    // parameters - значения параметров по номерам (пустой std::any - NULL).
+    static std::string execute(Database& db, const Statement& statement, const std::vector<std::any>& parameters = {});
+    static std::string parse_and_execute(Database& db, const std::string& query) { return execute(db, parse(query)); }
+
+    // BEGIN / COMMIT / ROLLBACK / SAVEPOINT / RELEASE выполняются вне автоматической транзакции запроса.
+    static bool is_transaction_control(const std::string& query);
+    static bool is_transaction_control(const Statement& statement);
 };
@@ -0,0 +1,258 @@
+#include "storage_format.h"
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace storage {
+
+namespace {
+
+constexpr uint64_t kFnvOffset = 14695981039346656037ull;
+constexpr uint64_t kFnvPrime = 1099511628211ull;
+constexpr uint64_t kMaxBlockSize = uint64_t(1) << 40; // Защита от повреждённой длины блока
+
+size_t padding_for(uint64_t offset) {
+    return static_cast<size_t>((8 - (offset & 7)) & 7);
+}
+
+void check_header(const char* magic, uint32_t version) {
+    if (std::memcmp(magic, kMagic, sizeof(kMagic)) != 0) {
+        throw std::runtime_error("Not a binary database file.");
+    }
+    if (version != kFormatVersion) {
+        throw std::runtime_error("Unsupported database format version: " + std::to_string(version));
+    }
+}
+
+} // namespace
+
+uint64_t checksum64(const void* data, size_t size) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    uint64_t hash = kFnvOffset;
+    size_t words = size / 8;
+    for (size_t i = 0; i < words; ++i) {
+        uint64_t word;
+        std::memcpy(&word, bytes + i * 8, 8);
+        hash = (hash ^ word) * kFnvPrime;
+    }
+    for (size_t i = words * 8; i < size; ++i) {
+        hash = (hash ^ bytes[i]) * kFnvPrime;
+    }
+    return hash ^ size;
+}
+
+void ByteBuffer::put_u32(uint32_t value) {
+    buffer.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void ByteBuffer::put_u64(uint64_t value) {
+    buffer.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void ByteBuffer::put_string(const std::string& value) {
+    put_u32(static_cast<uint32_t>(value.size()));
+    buffer.append(value);
+}
+
+void ByteCursor::require(size_t size) const {
+    if (static_cast<size_t>(end - data) < size) {
+        throw std::runtime_error("Corrupted block: unexpected end of data.");
+    }
+}
+
+uint32_t ByteCursor::get_u32() {
+    require(sizeof(uint32_t));
+    uint32_t value;
+    std::memcpy(&value, data, sizeof(value));
+    data += sizeof(value);
+    return value;
+}
+
+uint64_t ByteCursor::get_u64() {
+    require(sizeof(uint64_t));
+    uint64_t value;
+    std::memcpy(&value, data, sizeof(value));
+    data += sizeof(value);
+    return value;
+}
+
+std::string ByteCursor::get_string() {
+    uint32_t size = get_u32();
+    require(size);
+    std::string value(data, size);
+    data += size;
+    return value;
+}
+
+void BinaryWriter::write_raw(const void* data, size_t size) {
+    out.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+    if (!out) {
+        throw std::runtime_error("Failed to write database file.");
+    }
+    offset += size;
+}
+
+void BinaryWriter::pad() {
+    static const char zeros[8] = {};
+    write_raw(zeros, padding_for(offset));
+}
+
+void BinaryWriter::write_header() {
+    write_raw(kMagic, sizeof(kMagic));
+    write_raw(&kFormatVersion, sizeof(kFormatVersion));
+    uint64_t directory_position = 0;
+    write_raw(&directory_position, sizeof(directory_position));
+}
+
+void BinaryWriter::align() {
+    pad();
+}
+
+void BinaryWriter::write_block(const void* data, size_t size) {
+    uint64_t size64 = size;
+    write_raw(&size64, sizeof(size64));
+    pad();
+    write_raw(data, size);
+    pad();
+    uint64_t checksum = checksum64(data, size);
+    write_raw(&checksum, sizeof(checksum));
+}
+
+void BinaryWriter::write_bytes(const void* data, size_t size) {
+    if (padding_for(offset) != 0) {
+        throw std::runtime_error("Copied blocks must start at an aligned position.");
+    }
+    write_raw(data, size);
+}
+
+
+
+void BinaryReader::read_raw(void* data, size_t size) {
+    in.read(static_cast<char*>(data), static_cast<std::streamsize>(size));
+    if (static_cast<size_t>(in.gcount()) != size) {
+        throw std::runtime_error("Unexpected end of database file.");
+    }
+    offset += size;
+}
+
+uint64_t BinaryReader::read_u64() {
+    uint64_t value;
+    read_raw(&value, sizeof(value));
+    return value;
+}
+
+void BinaryReader::skip_padding() {
+    char zeros[8];
+    read_raw(zeros, padding_for(offset));
+}
+
+uint64_t BinaryReader::read_header() {
+    char magic[sizeof(kMagic)];
+    read_raw(magic, sizeof(magic));
+    uint32_t version;
+    read_raw(&version, sizeof(version));
+    check_header(magic, version);
+    return read_u64();
+}
+
+void BinaryReader::seek(uint64_t position) {
+    in.clear();
+    in.seekg(static_cast<std::streamoff>(position));
+    if (!in) {
+        throw std::runtime_error("Corrupted offset in database file.");
+    }
+    offset = position;
+}
+
+void BinaryReader::read_block_into(void* data, size_t expected_size) {
+    uint64_t size = read_u64();
+    if (size != expected_size) {
+        throw std::runtime_error("Corrupted block: expected " + std::to_string(expected_size) +
+            " bytes, found " + std::to_string(size) + ".");
+    }
+    skip_padding();
+    read_raw(data, expected_size);
+    skip_padding();
+    if (read_u64() != checksum64(data, expected_size)) {
+        throw std::runtime_error("Checksum mismatch in database file.");
+    }
+}
+
+std::string BinaryReader::read_block() {
+    uint64_t size = read_u64();
+    if (size > kMaxBlockSize) {
+        throw std::runtime_error("Corrupted block length in database file.");
+    }
+    std::string bytes(static_cast<size_t>(size), '\0');
+    skip_padding();
+    read_raw(bytes.data(), bytes.size());
+    skip_padding();
+    if (read_u64() != checksum64(bytes.data(), bytes.size())) {
+        throw std::runtime_error("Checksum mismatch in database file.");
+    }
+    return bytes;
+}
+
+void MemoryReader::require(size_t size) const {
+    if (static_cast<size_t>(end - current) < size) {
+        throw std::runtime_error("Unexpected end of database file.");
+    }
+}
+
+uint64_t MemoryReader::read_u64() {
+    require(sizeof(uint64_t));
+    uint64_t value;
+    std::memcpy(&value, current, sizeof(value));
+    current += sizeof(value);
+    return value;
+}
+
+void MemoryReader::skip_padding() {
+    size_t padding = padding_for(position());
+    require(padding);
+    current += padding;
+}
+
+void MemoryReader::seek(uint64_t position) {
+    if (position > size()) {
+        throw std::runtime_error("Corrupted offset in database file.");
+    }
+    current = begin + position;
+}
+
+uint64_t MemoryReader::read_header() {
+    require(sizeof(kMagic) + sizeof(uint32_t));
+    uint32_t version;
+    std::memcpy(&version, current + sizeof(kMagic), sizeof(version));
+    check_header(current, version);
+    current += sizeof(kMagic) + sizeof(uint32_t);
+    return read_u64();
+}
+
+std::string_view MemoryReader::read_block(bool verify) {
+    uint64_t size = read_u64();
+    skip_padding();
+    if (size > static_cast<uint64_t>(end - current)) {
+        throw std::runtime_error("Corrupted block length in database file.");
+    }
+    std::string_view block(current, static_cast<size_t>(size));
+    current += size;
+    skip_padding();
+    uint64_t checksum = read_u64();
+    if (verify && checksum != checksum64(block.data(), block.size())) {
+        throw std::runtime_error("Checksum mismatch in database file.");
+    }
+    return block;
+}
+
+void write_directory_position(const std::string& filename, uint64_t position) {
+    std::fstream file(filename, std::ios::in | std::ios::out | std::ios::binary);
+    file.seekp(static_cast<std::streamoff>(sizeof(kMagic) + sizeof(uint32_t)));
+    file.write(reinterpret_cast<const char*>(&position), sizeof(position));
+    file.close();
+    if (!file) {
+        throw std::runtime_error("Failed to write database file: " + filename);
+    }
+}
+
+} // namespace storage
@@ -0,0 +1,168 @@
+#pragma once
+#ifndef STORAGE_FORMAT_H
+#define STORAGE_FORMAT_H
+
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * Бинарный формат файла базы данных (little-endian).
+ *
+ * Файл: magic "CPDB", u32 версия, u64 позиция действующего каталога таблиц, затем блоки.
+ * Каталог: время последней фиксации, попавшей в файл, и для каждой таблицы имя, положение её блоков
+ * и цепочка дописанных изменений (инкрементальные контрольные точки дописывают изменения
+ * и новый каталог в конец файла, затем переключают позицию каталога в заголовке).
+ * Блок: u64 длина данных, выравнивание до 8 байт, данные, выравнивание до 8 байт, u64 контрольная сумма данных.
+ * Выравнивание считается от начала файла, поэтому массивы столбцов лежат в файле по границе 8 байт.
+ */
+namespace storage {
+
+constexpr char kMagic[4] = { 'C', 'P', 'D', 'B' };
+constexpr uint32_t kFormatVersion = 6;
+constexpr uint64_t kHeaderSize = 16;
+
+// Контрольная сумма блока: FNV-1a по 64-битным словам.
+uint64_t checksum64(const void* data, size_t size);
+
+/**
+ * @class ByteBuffer
+ * Сборка небольших блоков (схема, заголовок) в памяти перед записью.
+ */
+class ByteBuffer {
+public:
+    void put_u32(uint32_t value);
+    void put_u64(uint64_t value);
+    void put_string(const std::string& value);
+    void put_bytes(const std::string& bytes) { buffer.append(bytes); } // Без длины
+    const std::string& bytes() const { return buffer; }
+
+private:
+    std::string buffer;
+};
+
+/**
+ * @class ByteCursor
+ * Чтение полей из блока, прочитанного в память, с проверкой границ.
+ */
+class ByteCursor {
+public:
+    explicit ByteCursor(std::string_view bytes) : data(bytes.data()), end(bytes.data() + bytes.size()) {}
+    uint32_t get_u32();
+    uint64_t get_u64();
+    std::string get_string();
+
+private:
+    const char* data;
+    const char* end;
+    void require(size_t size) const;
+};
+
+/**
+ * @class BinaryWriter
+ * Последовательная запись блоков с выравниванием и контрольными суммами.
+ */
+class BinaryWriter {
+public:
+    // start - позиция потока в файле (дописывание в конец существующего файла).
+    explicit BinaryWriter(std::ostream& os, uint64_t start = 0) : out(os), offset(start) {}
+
+    void write_header(); // Позицию каталога после его записи проставляет write_directory_position
+    void align();        // Выравнивание позиции до 8 байт
+    void write_block(const void* data, size_t size);
+    void write_block(const std::string& bytes) { write_block(bytes.data(), bytes.size()); }
+    template <typename T>
+    void write_block(const std::vector<T>& values) { write_block(values.data(), values.size() * sizeof(T)); }
+
+    // Готовые блоки, скопированные из другого файла формата (позиция выровнена, как в исходном файле).
+    void write_bytes(const void* data, size_t size);
+
+    uint64_t position() const { return offset; }
+
+private:
+    std::ostream& out;
+    uint64_t offset = 0;
+
+    void write_raw(const void* data, size_t size);
+    void pad();
+};
+
+/**
+ * @class BinaryReader
+ * Чтение блоков, записанных BinaryWriter, с проверкой длины и контрольной суммы.
+ */
+class BinaryReader {
+public:
+    explicit BinaryReader(std::istream& is) : in(is) {}
+
+    // Проверяет magic и версию формата, возвращает позицию каталога.
+    uint64_t read_header();
+    void seek(uint64_t position);
+
+    std::string read_block();
+    template <typename T>
+    std::vector<T> read_block_as(size_t expected_count) {
+        std::vector<T> values(expected_count);
+        read_block_into(values.data(), expected_count * sizeof(T));
+        return values;
+    }
+
+    uint64_t position() const { return offset; }
+
+private:
+    std::istream& in;
+    uint64_t offset = 0;
+
+    void read_raw(void* data, size_t size);
+    uint64_t read_u64();
+    void skip_padding();
+    void read_block_into(void* data, size_t expected_size);
+};
+
+/**
+ * @class MemoryReader
+ * Чтение блоков прямо из памяти (отображённого файла) без копирования.
+ * Данные блока возвращаются указателем внутрь буфера.
+ */
+class MemoryReader {
+public:
+    MemoryReader(const char* data, size_t size) : begin(data), end(data + size), current(data) {}
+
+    uint64_t read_header(); // Возвращает позицию каталога
+
+    // verify = false пропускает проверку контрольной суммы, чтобы не читать страницы данных заранее.
+    std::string_view read_block(bool verify = true);
+    template <typename T>
+    const T* read_array(size_t expected_count, bool verify = true) {
+        std::string_view block = read_block(verify);
+        if (block.size() != expected_count * sizeof(T)) {
+            throw std::runtime_error("Corrupted block: expected " + std::to_string(expected_count * sizeof(T)) +
+                " bytes, found " + std::to_string(block.size()) + ".");
+        }
+        return reinterpret_cast<const T*>(block.data());
+    }
+
+    uint64_t position() const { return static_cast<uint64_t>(current - begin); }
+    void seek(uint64_t position);
+    uint64_t size() const { return static_cast<uint64_t>(end - begin); }
+
+private:
+    const char* begin;
+    const char* end;
+    const char* current;
+
+    void require(size_t size) const;
+    uint64_t read_u64();
+    void skip_padding();
+};
+
+// Переключает действующий каталог файла (после того как новый каталог записан и сброшен на диск).
+void write_directory_position(const std::string& filename, uint64_t position);
+
+} // namespace storage
+
+#endif // STORAGE_FORMAT_H
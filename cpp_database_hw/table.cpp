@@ -5,12 +5,14 @@
 #include <functional>
 #include <iostream>
 #include "utils.h"
+#include "thread_pool.h"
 #include "ordered_index.h"
 #include <unordered_map>
-#include <regex>
 #include <iomanip> 
+#include <limits>
+#include <bitset>
 
-//  
+// Конструктор таблицы
 Table::Table(const std::map<std::string, std::string>& schema) {
     for (const auto& [col_name, col_type] : schema) {
         std::string clean_col_name = trim(col_name);
@@ -18,91 +20,548 @@ Table::Table(const std::map<std::string, std::string>& schema) {
         if (clean_col_name.empty() || clean_col_type.empty()) {
             throw std::runtime_error("Schema contains empty column name or type.");
         }
-        columns.push_back(clean_col_name);
-        column_types[clean_col_name] = clean_col_type;
+        add_column(clean_col_name, clean_col_type);
     }
 }
 
-//   is_unique
-bool Table::is_unique(const std::string& column_name, const std::any& value) const {
-    auto it = std::find(columns.begin(), columns.end(), column_name);
-    if (it == columns.end()) {
+void Table::add_constraint(const std::string& column, const std::string& constraint) {
+    if (std::find(columns.begin(), columns.end(), column) == columns.end()) {
+        throw std::runtime_error("Constraint on unknown column '" + column + "'.");
+    }
+    if (constraint != "PRIMARY KEY" && constraint != "UNIQUE" && constraint != "NOT NULL") {
+        throw std::runtime_error("Unsupported constraint '" + constraint + "' for column '" + column + "'.");
+    }
+    if (row_count > 0) {
+        throw std::runtime_error("Constraints can only be added to an empty table.");
+    }
+    if (constraints.count(column)) {
+        throw std::runtime_error("Column '" + column + "' already has a constraint.");
+    }
+    if (constraint == "PRIMARY KEY") {
+        for (const auto& [other_column, other_constraint] : constraints) {
+            if (other_constraint == "PRIMARY KEY") {
+                throw std::runtime_error("Table can have only one PRIMARY KEY.");
+            }
+        }
+    }
+    constraints[column] = constraint;
+    if (is_unique_column(column) && indices.find(column) == indices.end()) {
+        indices[column] = UnorderedIndex(); // Таблица пуста, индекс заполняется при вставке
+    }
+    require_full_save();
+}
+
+bool Table::is_unique_column(const std::string& column) const {
+    auto constraint = constraints.find(column);
+    return constraint != constraints.end() && (constraint->second == "UNIQUE" || constraint->second == "PRIMARY KEY");
+}
+
+bool Table::is_not_null_column(const std::string& column) const {
+    auto constraint = constraints.find(column);
+    return constraint != constraints.end() && (constraint->second == "NOT NULL" || constraint->second == "PRIMARY KEY");
+}
+
+// Добавление столбца в схему и колоночное хранилище
+void Table::add_column(const std::string& name, const std::string& type) {
+    data.emplace_back(parse_column_type(type));
+    data.back().reserve(row_count);
+    for (size_t i = 0; i < row_count; ++i) {
+        data.back().append_null();
+    }
+    columns.push_back(name);
+    column_types[name] = type;
+}
+
+// Строка таблицы в виде map (имя столбца -> значение)
+std::map<std::string, std::any> Table::row_to_map(size_t row) const {
+    std::map<std::string, std::any> mapped_row;
+    for (size_t i = 0; i < columns.size(); ++i) {
+        mapped_row.emplace_hint(mapped_row.end(), columns[i], data[i].get(row));
+    }
+    return mapped_row;
+}
+
+// Реализация метода is_unique
+bool Table::is_unique(const std::string& column_name, const std::any& value, const Transaction* txn) const {
+    if (std::find(columns.begin(), columns.end(), column_name) == columns.end()) {
         throw std::runtime_error("Column '" + column_name + "' not found.");
     }
+    return find_duplicate(column_name, { value }, txn) == kNoDuplicate;
+}
 
-    size_t column_index = std::distance(columns.begin(), it);
-    for (const auto& row : rows) {
-        if (row[column_index].has_value()) {
-            if (row[column_index].type() == value.type()) {
-                if (row[column_index].type() == typeid(int)) {
-                    if (std::any_cast<int>(row[column_index]) == std::any_cast<int>(value)) {
-                        return false; //   
+namespace {
+
+// Значение для сообщения об ошибке
+std::string value_text(const std::any& value) {
+    if (value.type() == typeid(int)) {
+        return std::to_string(std::any_cast<int>(value));
+    }
+    if (value.type() == typeid(bool)) {
+        return std::any_cast<bool>(value) ? "true" : "false";
+    }
+    if (value.type() == typeid(std::string)) {
+        return "'" + std::any_cast<const std::string&>(value) + "'";
+    }
+    return "NULL";
+}
+
+// Повторения значений одного типа. Значения пакета собираются в хеш-таблицу (ключ -> первый номер),
+// затем занятые значения ищутся либо по хеш-индексу столбца, либо одним проходом по столбцу.
+template <typename Key, typename ValueKey, typename FindOccupied>
+size_t first_duplicate(const Column& column, const std::vector<std::any>& values, ValueKey value_key, FindOccupied find_occupied) {
+    std::unordered_map<Key, size_t> batch;
+    batch.reserve(values.size());
+    size_t first = Table::kNoDuplicate;
+    for (size_t i = 0; i < values.size(); ++i) {
+        if (!values[i].has_value() || !column.accepts(values[i])) {
+            continue;
+        }
+        if (!batch.try_emplace(value_key(values[i]), i).second) {
+            first = i; // Дальше искать в пакете незачем: нужен наименьший номер
+            break;
+        }
+    }
+    if (!batch.empty()) {
+        find_occupied(batch, first);
+    }
+    return first;
+}
+
+} // namespace
+
+size_t Table::find_duplicate(const std::string& column_name, const std::vector<std::any>& values, const Transaction* txn) const {
+    size_t col_index = get_column_index(column_name);
+    const Column& column = data[col_index];
+    auto index = indices.find(column_name);
+
+    auto check = [&](auto value_key, auto row_key) {
+        using Key = decltype(row_key(size_t(0)));
+        return first_duplicate<Key>(column, values, value_key, [&](const std::unordered_map<Key, size_t>& batch, size_t& first) {
+            if (index != indices.end()) {
+                for (const auto& [key, i] : batch) {
+                    if (i >= first) {
+                        continue;
                     }
-                }
-                else if (row[column_index].type() == typeid(std::string)) {
-                    if (std::any_cast<std::string>(row[column_index]) == std::any_cast<std::string>(value)) {
-                        return false; //   
+                    IndexRows rows = index->second.lookup(values[i]);
+                    if (std::any_of(rows.begin(), rows.end(), [&](size_t row) { return holds_value(row, txn); })) {
+                        first = i;
                     }
                 }
-                else if (row[column_index].type() == typeid(bool)) {
-                    if (std::any_cast<bool>(row[column_index]) == std::any_cast<bool>(value)) {
-                        return false; //   
-                    }
+                return;
+            }
+            for (size_t row = 0; row < row_count; ++row) {
+                if (column.is_null(row) || !holds_value(row, txn)) {
+                    continue;
                 }
-                else {
-                    throw std::runtime_error("Unsupported type for uniqueness check.");
+                auto it = batch.find(row_key(row));
+                if (it != batch.end() && it->second < first) {
+                    first = it->second;
                 }
             }
-        }
+        });
+    };
+
+    switch (column.type()) {
+    case ColumnType::Int32:
+        return check([](const std::any& value) { return static_cast<int32_t>(std::any_cast<int>(value)); },
+            [&column](size_t row) { return column.get_int(row); });
+    case ColumnType::String:
+        return check([](const std::any& value) { return std::string_view(std::any_cast<const std::string&>(value)); },
+            [&column](size_t row) { return column.get_string(row); });
+    case ColumnType::Bool:
+        return check([](const std::any& value) { return std::any_cast<bool>(value); },
+            [&column](size_t row) { return column.get_bool(row); });
     }
-
-    return true; //  
+    return kNoDuplicate;
 }
 
-//  
-void Table::save(std::ostream& os) const {
+// Сохранение таблицы в бинарном формате.
+// Блоки: схема, битовая карта удалённых строк, блоки каждого столбца, затем блоки индексов
+// (хеш-индексы, потом упорядоченные, в порядке схемы; см. PersistedIndex).
+// Все позиции строк сохраняются, поэтому номера строк не меняются после загрузки.
+void Table::save(storage::BinaryWriter& out) const {
     if (columns.empty()) {
         throw std::runtime_error("Cannot save: no columns defined.");
     }
 
-    os << columns.size() << "\n";
+    storage::ByteBuffer schema;
+    schema.put_u32(static_cast<uint32_t>(columns.size()));
     for (const auto& col : columns) {
-        os << col << " " << column_types.at(col) << "\n";
+        schema.put_string(col);
+        schema.put_string(column_types.at(col));
+    }
+    schema.put_u32(static_cast<uint32_t>(constraints.size()));
+    for (const auto& [col, constraint] : constraints) {
+        schema.put_string(col);
+        schema.put_string(constraint);
+    }
+    schema.put_u64(row_count);
+    schema.put_u32(static_cast<uint32_t>(indices.size()));
+    for (const auto& [col, index] : indices) {
+        schema.put_string(col);
     }
+    schema.put_u32(static_cast<uint32_t>(ordered_indices.size()));
+    for (const auto& [col, index] : ordered_indices) {
+        schema.put_string(col);
+    }
+    out.write_block(schema.bytes());
 
-    os << rows.size() << "\n";
-    for (const auto& row : rows) {
-        for (size_t j = 0; j < row.size(); ++j) {
-            const auto& cell = row[j];
-            if (cell.has_value()) {
-                if (cell.type() == typeid(int)) {
-                    os << "int " << std::any_cast<int>(cell);
-                }
-                else if (cell.type() == typeid(std::string)) {
-                    os << "string " << std::any_cast<std::string>(cell);
-                }
-                else if (cell.type() == typeid(bool)) {
-                    os << "bool " << (std::any_cast<bool>(cell) ? "true" : "false");
-                }
-                else {
-                    os << "null";
-                }
+    // Сохраняется последнее зафиксированное состояние: невидимые в нём версии записываются как удалённые
+    std::vector<uint64_t> saved_deleted = deleted_rows;
+    if (versioned) {
+        for (size_t word = 0; word < saved_deleted.size(); ++word) {
+            saved_deleted[word] = saved_deleted_word(word);
+        }
+    }
+    out.write_block(saved_deleted);
+
+    const std::vector<uint64_t>* deleted = (live_rows == row_count) ? nullptr : &saved_deleted;
+    for (const auto& column : data) {
+        column.save(out, deleted);
+    }
+    for (const auto& [col, index] : indices) {
+        PersistedIndex::save(out, data[get_column_index(col)], saved_deleted);
+    }
+    for (const auto& [col, index] : ordered_indices) {
+        PersistedIndex::save(out, data[get_column_index(col)], saved_deleted);
+    }
+}
+
+uint64_t Table::saved_deleted_word(size_t word) const {
+    uint64_t saved = deleted_rows[word];
+    if (versioned) {
+        size_t end = std::min(row_count, (word + 1) * 64);
+        for (size_t row = word * 64; row < end; ++row) {
+            if (!is_visible(row, nullptr)) {
+                saved |= uint64_t(1) << (row & 63);
             }
-            else {
-                os << "null";
+        }
+    }
+    return saved;
+}
+
+bool Table::has_unsaved_changes() const {
+    if (needs_full_save() || row_count != persisted_rows) {
+        return true;
+    }
+    for (uint64_t stamp : segment_stamps) {
+        if (stamp > persisted_stamp) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Блок изменений: заголовок (строк в файле, строк сейчас, номера сегментов), слова битовой карты
+// удалённых строк этих сегментов, затем по столбцу со значениями дописанных строк
+void Table::save_changes(storage::BinaryWriter& out) const {
+    const size_t segment_words = kSegmentRows / 64;
+    size_t segment_count = (row_count + kSegmentRows - 1) / kSegmentRows;
+    std::vector<uint64_t> segments;
+    for (size_t segment = 0; segment < segment_count; ++segment) {
+        bool changed = segment < segment_stamps.size() && segment_stamps[segment] > persisted_stamp;
+        bool has_new_rows = (segment + 1) * kSegmentRows > persisted_rows;
+        if (changed || has_new_rows) {
+            segments.push_back(segment);
+        }
+    }
+
+    storage::ByteBuffer header;
+    header.put_u64(persisted_rows);
+    header.put_u64(row_count);
+    header.put_u64(segments.size());
+    for (uint64_t segment : segments) {
+        header.put_u64(segment);
+    }
+    out.write_block(header.bytes());
+
+    std::vector<uint64_t> words;
+    for (uint64_t segment : segments) {
+        size_t end = std::min(deleted_rows.size(), static_cast<size_t>(segment + 1) * segment_words);
+        for (size_t word = static_cast<size_t>(segment) * segment_words; word < end; ++word) {
+            words.push_back(saved_deleted_word(word));
+        }
+    }
+    out.write_block(words);
+
+    for (const auto& column : data) {
+        Column appended(column.type());
+        appended.reserve(row_count - persisted_rows);
+        for (size_t row = persisted_rows; row < row_count; ++row) {
+            appended.append_from(column, row);
+        }
+        appended.save(out, nullptr);
+    }
+}
+
+void Table::load_changes(storage::MemoryReader& in) {
+    const size_t segment_words = kSegmentRows / 64;
+    storage::ByteCursor header(in.read_block());
+    uint64_t base_rows = header.get_u64();
+    uint64_t new_rows = header.get_u64();
+    if (base_rows != row_count || new_rows < base_rows) {
+        throw std::runtime_error("Corrupted change block in database file.");
+    }
+    std::vector<uint64_t> segments(static_cast<size_t>(header.get_u64()));
+    size_t new_words = static_cast<size_t>((new_rows + 63) / 64);
+    size_t word_count = 0;
+    for (auto& segment : segments) {
+        segment = header.get_u64();
+        size_t first = static_cast<size_t>(segment) * segment_words;
+        if (first >= new_words) {
+            throw std::runtime_error("Corrupted change block in database file.");
+        }
+        word_count += std::min(new_words, first + segment_words) - first;
+    }
+    const uint64_t* words = in.read_array<uint64_t>(word_count);
+
+    // Дописанные строки
+    size_t appended_rows = static_cast<size_t>(new_rows - base_rows);
+    for (auto& column : data) {
+        Column appended(column.type());
+        appended.load(in, appended_rows);
+        if (appended_rows == 0) {
+            continue; // Отображённый столбец не копируется в память без нужды
+        }
+        column.reserve(row_count + appended_rows);
+        for (size_t row = 0; row < appended_rows; ++row) {
+            column.append_from(appended, row);
+        }
+    }
+    for (size_t row = 0; row < appended_rows; ++row) {
+        append_row_slot();
+    }
+
+    // Видимость строк изменённых сегментов; индексы следуют за ней
+    for (uint64_t segment : segments) {
+        size_t first = static_cast<size_t>(segment) * segment_words;
+        size_t end = std::min(new_words, first + segment_words);
+        for (size_t word = first; word < end; ++word, ++words) {
+            uint64_t changed = deleted_rows[word] ^ *words;
+            for (size_t bit = 0; bit < 64 && changed; ++bit, changed >>= 1) {
+                size_t row = word * 64 + bit;
+                if ((changed & 1) && row < base_rows) {
+                    if ((*words >> bit) & 1) {
+                        unindex_row(row);
+                    }
+                    else {
+                        index_row(row);
+                    }
+                }
             }
-            if (j < row.size() - 1) os << " ";
+            deleted_rows[word] = *words;
         }
-        os << "\n";
+    }
+    for (size_t row = static_cast<size_t>(base_rows); row < row_count; ++row) {
+        if (!is_deleted(row)) {
+            index_row(row);
+        }
+    }
+
+    live_rows = row_count;
+    for (uint64_t word : deleted_rows) {
+        live_rows -= std::bitset<64>(word).count();
+    }
+    persisted_rows = row_count;
+}
+
+void Table::mark_persisted(const SaveMark& mark) {
+    persisted_rows = mark.rows;
+    persisted_stamp = mark.stamp;
+}
+
+void Table::touch_segment(size_t row) {
+    size_t segment = row / kSegmentRows;
+    if (segment >= segment_stamps.size()) {
+        segment_stamps.resize(segment + 1, 0);
+    }
+    segment_stamps[segment] = ++change_stamp;
+}
+
+// Разбор блока схемы; возвращает количество позиций строк и столбцы сохранённых индексов
+uint64_t Table::read_schema(std::string_view schema_bytes, IndexColumns& index_columns) {
+    columns.clear();
+    column_types.clear();
+    data.clear();
+    indices.clear();
+    ordered_indices.clear();
+    constraints.clear();
+    row_count = 0;
+    live_rows = 0;
+    deleted_rows.clear();
+    versioned = false;
+    version_begin.clear();
+    version_end.clear();
+    retired_rows.clear();
+    free_rows.clear();
+    change_stamp = 0;
+    persisted_stamp = 0;
+    full_save_stamp = 0;
+    segment_stamps.clear();
+
+    storage::ByteCursor schema(schema_bytes);
+    uint32_t col_count = schema.get_u32();
+    if (col_count == 0) {
+        throw std::runtime_error("Column count out of valid range.");
+    }
+    for (uint32_t i = 0; i < col_count; ++i) {
+        std::string col_name = schema.get_string();
+        std::string col_type = schema.get_string();
+        add_column(col_name, col_type);
+    }
+    uint32_t constraint_count = schema.get_u32();
+    for (uint32_t i = 0; i < constraint_count; ++i) {
+        std::string col_name = schema.get_string();
+        constraints[col_name] = schema.get_string();
+    }
+    uint64_t stored_rows = schema.get_u64();
+
+    index_columns.hash.resize(schema.get_u32());
+    for (auto& col_name : index_columns.hash) {
+        col_name = schema.get_string();
+    }
+    index_columns.stored_hash = index_columns.hash.size();
+    for (const auto& [col_name, constraint] : constraints) {
+        // Ограничение уникальности всегда опирается на хеш-индекс
+        if (is_unique_column(col_name) &&
+            std::find(index_columns.hash.begin(), index_columns.hash.end(), col_name) == index_columns.hash.end()) {
+            index_columns.hash.push_back(col_name);
+        }
+    }
+    index_columns.ordered.resize(schema.get_u32());
+    for (auto& col_name : index_columns.ordered) {
+        col_name = schema.get_string();
+    }
+    return stored_rows;
+}
+
+void Table::set_deleted_rows(std::vector<uint64_t> deleted, uint64_t stored_rows) {
+    deleted_rows = std::move(deleted);
+    if (stored_rows % 64 != 0) {
+        deleted_rows.back() &= (uint64_t(1) << (stored_rows % 64)) - 1; // Биты за последней строкой не используются
+    }
+    row_count = stored_rows;
+    persisted_rows = stored_rows;
+    live_rows = row_count;
+    for (uint64_t word : deleted_rows) {
+        live_rows -= std::bitset<64>(word).count();
+    }
+}
+
+// Загрузка таблицы из бинарного формата.
+// Блоки столбцов проверяются и копируются параллельно, затем параллельно копируются сохранённые индексы.
+void Table::load(storage::MemoryReader& in) {
+    IndexColumns index_columns;
+    uint64_t stored_rows = read_schema(in.read_block(), index_columns);
+    size_t words = static_cast<size_t>((stored_rows + 63) / 64);
+    const uint64_t* deleted = in.read_array<uint64_t>(words);
+
+    std::vector<uint64_t> column_positions;
+    column_positions.reserve(data.size());
+    for (const auto& column : data) {
+        column_positions.push_back(in.position());
+        column.skip(in);
+    }
+    ThreadPool::shared().parallel_for(data.size(), [&](size_t i) {
+        storage::MemoryReader column_in = in;
+        column_in.seek(column_positions[i]);
+        data[i].load(column_in, stored_rows);
+    });
+
+    set_deleted_rows(std::vector<uint64_t>(deleted, deleted + words), stored_rows);
+    attach_indices(in, index_columns, nullptr, true);
+    ThreadPool::shared().parallel_for(indices.size() + ordered_indices.size(), [&](size_t i) {
+        if (i < indices.size()) {
+            std::next(indices.begin(), i)->second.materialize();
+        }
+        else {
+            std::next(ordered_indices.begin(), i - indices.size())->second.materialize();
+        }
+    });
+}
+
+// Подключение таблицы к отображённому файлу: столбцы и индексы читаются прямо из него.
+// Копируется только битовая карта удалённых строк.
+void Table::attach(storage::MemoryReader& in, const std::shared_ptr<const storage::MappedFile>& file) {
+    IndexColumns index_columns;
+    uint64_t stored_rows = read_schema(in.read_block(), index_columns);
+    size_t words = static_cast<size_t>((stored_rows + 63) / 64);
+    const uint64_t* deleted = in.read_array<uint64_t>(words);
+    for (auto& column : data) {
+        column.attach(in, stored_rows, file);
+    }
+    set_deleted_rows(std::vector<uint64_t>(deleted, deleted + words), stored_rows);
+    attach_indices(in, index_columns, file, false);
+}
+
+// Подключение блоков индексов, записанных после столбцов; индексы ограничений,
+// которых нет в схеме, строятся по столбцам
+void Table::attach_indices(storage::MemoryReader& in, const IndexColumns& index_columns,
+    const std::shared_ptr<const storage::MappedFile>& file, bool verify) {
+    for (size_t i = 0; i < index_columns.stored_hash; ++i) {
+        const std::string& col_name = index_columns.hash[i];
+        PersistedIndex persisted;
+        persisted.attach(in, data[get_column_index(col_name)].type(), row_count, file, verify);
+        indices[col_name].attach(std::move(persisted));
+    }
+    for (const auto& col_name : index_columns.ordered) {
+        PersistedIndex persisted;
+        persisted.attach(in, data[get_column_index(col_name)].type(), row_count, file, verify);
+        ordered_indices[col_name].attach(std::move(persisted));
+    }
+    IndexColumns missing;
+    missing.hash.assign(index_columns.hash.begin() + index_columns.stored_hash, index_columns.hash.end());
+    rebuild_indices(missing);
+}
+
+// Построение сохранённых индексов, по задаче пула на индекс
+void Table::rebuild_indices(const IndexColumns& index_columns) {
+    std::vector<size_t> hash_columns, ordered_columns;
+    for (const auto& col_name : index_columns.hash) {
+        hash_columns.push_back(get_column_index(col_name));
+    }
+    for (const auto& col_name : index_columns.ordered) {
+        ordered_columns.push_back(get_column_index(col_name));
+    }
+
+    std::vector<UnorderedIndex> built_hash(hash_columns.size());
+    std::vector<OrderedUnorderedIndex> built_ordered(ordered_columns.size());
+    ThreadPool::shared().parallel_for(hash_columns.size() + ordered_columns.size(), [&](size_t i) {
+        if (i < hash_columns.size()) {
+            built_hash[i] = build_hash_index(hash_columns[i]);
+        }
+        else {
+            size_t j = i - hash_columns.size();
+            built_ordered[j] = build_ordered_index(ordered_columns[j]);
+        }
+    });
+
+    for (size_t i = 0; i < hash_columns.size(); ++i) {
+        indices[index_columns.hash[i]] = std::move(built_hash[i]);
+    }
+    for (size_t i = 0; i < ordered_columns.size(); ++i) {
+        ordered_indices[index_columns.ordered[i]] = std::move(built_ordered[i]);
     }
 }
 
+// Копирует отображённые столбцы и индексы в память, после чего файл можно перезаписать
+void Table::detach() {
+    for (auto& column : data) {
+        column.materialize();
+    }
+    for (auto& [col, index] : indices) {
+        index.materialize();
+    }
+    for (auto& [col, index] : ordered_indices) {
+        index.materialize();
+    }
+}
 
-//  
-void Table::load(std::istream& is) {
+// Загрузка таблицы из текстового формата прежних версий
+void Table::load_text(std::istream& is) {
     std::string line;
 
-    //   
+    // Чтение количества столбцов
     while (std::getline(is, line) && line.empty()) {}
     line = trim(line);
     if (line.empty()) throw std::runtime_error("Column count line is empty.");
@@ -118,9 +577,18 @@ void Table::load(std::istream& is) {
         throw std::runtime_error("Column count out of valid range.");
     }
 
-    //   
+    // Чтение схемы столбцов
     columns.clear();
     column_types.clear();
+    data.clear();
+    row_count = 0;
+    live_rows = 0;
+    deleted_rows.clear();
+    versioned = false;
+    version_begin.clear();
+    version_end.clear();
+    retired_rows.clear();
+    free_rows.clear();
     for (size_t i = 0; i < col_count; ++i) {
         std::string col_name, col_type;
         if (!(is >> col_name >> col_type)) {
@@ -131,57 +599,62 @@ void Table::load(std::istream& is) {
         if (col_name.empty() || col_type.empty()) {
             throw std::runtime_error("Column name or type is empty.");
         }
-        columns.push_back(col_name);
-        column_types[col_name] = col_type;
+        add_column(col_name, col_type);
     }
     is.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
 
-    //   
+    // Чтение количества строк
     while (std::getline(is, line) && line.empty()) {}
     line = trim(line);
     if (line.empty()) throw std::runtime_error("Row count line is empty.");
 
-    size_t row_count = 0;
+    size_t stored_rows = 0;
     try {
-        row_count = std::stoul(line);
+        stored_rows = std::stoul(line);
     }
     catch (...) {
         throw std::runtime_error("Invalid row count: " + line);
     }
-    if (row_count > 100000) {
+    if (stored_rows > 100000) {
         throw std::runtime_error("Row count exceeds reasonable limit.");
     }
 
-    //   
-    rows.clear();
-    rows.resize(row_count);
-    for (size_t i = 0; i < row_count; ++i) {
-        rows[i].resize(columns.size());
+    // Чтение строк данных
+    for (auto& column : data) {
+        column.reserve(stored_rows);
+    }
+    for (size_t i = 0; i < stored_rows; ++i) {
         for (size_t j = 0; j < columns.size(); ++j) {
+            Column& column = data[j];
             std::string type, value;
-            if (!(is >> type >> value)) {
+            if (!(is >> type)) {
                 throw std::runtime_error("Failed to read cell data at row " + std::to_string(i) + ", column " + std::to_string(j));
             }
             type = trim(type);
+            // Для NULL записывается только тип, без значения
+            if (type == "null") {
+                column.append_null();
+                continue;
+            }
+            if (!(is >> value)) {
+                throw std::runtime_error("Failed to read cell data at row " + std::to_string(i) + ", column " + std::to_string(j));
+            }
             value = trim(value);
             try {
-                if (type == "null") {
-                    rows[i][j] = std::any();
-                }
-                else if (type == "int") {
+                if (type == "int") {
                     if (!is_numeric(value)) {
                         throw std::runtime_error("Invalid integer value: " + value);
                     }
-                    rows[i][j] = std::stoi(value);
+                    column.append_int(std::stoi(value));
                 }
                 else if (type == "string") {
-                    rows[i][j] = value;
+                    column.append_string(value);
                 }
                 else if (type == "bool") {
                     if (value != "true" && value != "false") {
                         throw std::runtime_error("Invalid boolean value: " + value);
                     }
-                    rows[i][j] = (value == "true");
+                    column.append_bool(value == "true");
                 }
                 else {
                     throw std::runtime_error("Unknown type: " + type);
@@ -191,66 +664,67 @@ void Table::load(std::istream& is) {
                 throw std::runtime_error("Error parsing cell at row " + std::to_string(i) + ", column " + std::to_string(j) + ": " + e.what());
             }
         }
+        append_row_slot();
+        ++live_rows;
         is.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
     }
 }
 
-std::vector<std::map<std::string, std::any>> Table::select(const std::string& condition) const {
-    std::vector<std::map<std::string, std::any>> result;
-    auto condition_fn = parse_condition(condition);
+std::vector<std::map<std::string, std::any>> Table::select(const std::string& condition, const Transaction* txn) const {
+    return select(Condition::parse(condition), txn);
+}
 
-    for (const auto& row : rows) {
-        std::map<std::string, std::any> mapped_row;
-        for (size_t i = 0; i < columns.size(); ++i) {
-            try {
-                if (row[i].type() == typeid(int)) {
-                    mapped_row[columns[i]] = std::any_cast<int>(row[i]);
-                }
-                else if (row[i].type() == typeid(std::string)) {
-                    mapped_row[columns[i]] = std::any_cast<std::string>(row[i]);
-                }
-                else if (row[i].type() == typeid(bool)) {
-                    mapped_row[columns[i]] = std::any_cast<bool>(row[i]);
-                }
-                else {
-                    mapped_row[columns[i]] = std::any(); // NULL value
-                }
-            }
-            catch (const std::exception& e) {
-                throw std::runtime_error("Error processing row value for column '" + columns[i] + "': " + e.what());
-            }
-        }
-        if (condition_fn(mapped_row)) {
-            result.push_back(mapped_row);
+std::vector<std::map<std::string, std::any>> Table::select(const Condition& condition, const Transaction* txn) const {
+    Predicate predicate = compile_condition(condition);
+    std::vector<size_t> rows = find_rows(predicate, txn);
+
+    // Строки результата собираются параллельно теми же порциями, что и при проходе
+    std::vector<std::map<std::string, std::any>> result(rows.size());
+    size_t morsels = (rows.size() + kMorselRows - 1) / kMorselRows;
+    ThreadPool::shared().parallel_for(morsels, [&](size_t morsel) {
+        size_t end = std::min(rows.size(), (morsel + 1) * kMorselRows);
+        for (size_t i = morsel * kMorselRows; i < end; ++i) {
+            result[i] = row_to_map(rows[i]);
         }
-    }
+    });
     return result;
 }
 
+Cursor Table::scan(const std::string& condition, const Transaction* txn) const {
+    return scan(Condition::parse(condition), txn);
+}
+
+Cursor Table::scan(const Condition& condition, const Transaction* txn) const {
+    return Cursor(*this, compile_condition(condition), txn);
+}
+
 void Table::print(std::ostream& os) const {
-    //   
+    // Выводим заголовки столбцов
     for (const auto& column : columns) {
         os << std::setw(15) << column << " ";
     }
     os << "\n";
 
-    //  
+    // Выводим разделитель
     os << std::string(columns.size() * 16, '-') << "\n";
 
-    //  
-    for (const auto& row : rows) {
-        for (const auto& value : row) {
-            if (value.type() == typeid(std::string)) {
-                os << std::setw(15) << std::any_cast<std::string>(value) << " ";
+    // Выводим строки
+    for (size_t row = 0; row < row_count; ++row) {
+        if (!is_visible(row, nullptr)) {
+            continue;
+        }
+        for (const auto& column : data) {
+            if (column.is_null(row)) {
+                os << std::setw(15) << "NULL" << " ";
             }
-            else if (value.type() == typeid(int)) {
-                os << std::setw(15) << std::any_cast<int>(value) << " ";
+            else if (column.type() == ColumnType::String) {
+                os << std::setw(15) << column.get_string(row) << " ";
             }
-            else if (value.type() == typeid(bool)) {
-                os << std::setw(15) << (std::any_cast<bool>(value) ? "true" : "false") << " ";
+            else if (column.type() == ColumnType::Int32) {
+                os << std::setw(15) << column.get_int(row) << " ";
             }
             else {
-                os << std::setw(15) << "NULL" << " ";
+                os << std::setw(15) << (column.get_bool(row) ? "true" : "false") << " ";
             }
         }
         os << "\n";
@@ -266,7 +740,273 @@ size_t Table::get_column_index(const std::string& column_name) const {
 }
 
 
-Table Table::join(const Table& other, const std::string& on_this_field, const std::string& on_other_field) const {
+namespace {
+
+constexpr size_t kNoRow = static_cast<size_t>(-1);
+
+// Часть массива номеров строк (раздел входа соединения)
+class RowRange {
+public:
+    RowRange(const std::vector<size_t>& rows, size_t begin, size_t end) : first(rows.data() + begin), last(rows.data() + end) {}
+    explicit RowRange(const std::vector<size_t>& rows) : RowRange(rows, 0, rows.size()) {}
+    const size_t* begin() const { return first; }
+    const size_t* end() const { return last; }
+    size_t size() const { return static_cast<size_t>(last - first); }
+    size_t operator[](size_t i) const { return first[i]; }
+
+private:
+    const size_t* first;
+    const size_t* last;
+};
+
+/**
+ * @brief Хеш-соединение по одному ключевому столбцу.
+ * Хеш-таблица строится по build_rows (меньший вход), затем по ней проходят строки probe_rows.
+ * Цепочки одинаковых ключей хранятся в массиве next, поэтому на строку нет отдельного выделения памяти.
+ * @param matches Пары (строка build, строка probe); для каждой строки probe - по возрастанию строки build.
+ */
+template <typename Getter>
+void hash_join_rows(const Column& build_key, RowRange build_rows,
+    const Column& probe_key, RowRange probe_rows,
+    Getter get, std::vector<std::pair<size_t, size_t>>& matches) {
+    if (build_rows.size() == 0 || probe_rows.size() == 0) {
+        return;
+    }
+    using Key = decltype(get(build_key, 0));
+    std::unordered_map<Key, size_t> heads;
+    heads.reserve(build_rows.size());
+    std::vector<size_t> next(build_rows.size(), kNoRow);
+
+    // Проход с конца, чтобы цепочки шли по возрастанию номеров строк
+    for (size_t i = build_rows.size(); i-- > 0;) {
+        auto [it, inserted] = heads.try_emplace(get(build_key, build_rows[i]), i);
+        if (!inserted) {
+            next[i] = it->second;
+            it->second = i;
+        }
+    }
+
+    for (size_t probe_row : probe_rows) {
+        auto it = heads.find(get(probe_key, probe_row));
+        if (it == heads.end()) {
+            continue;
+        }
+        for (size_t i = it->second; i != kNoRow; i = next[i]) {
+            matches.emplace_back(build_rows[i], probe_row);
+        }
+    }
+}
+
+// Параметры разбиения входов соединения
+constexpr size_t kParallelJoinRows = 65536;   // Меньшие входы соединяются одной хеш-таблицей
+constexpr size_t kRadixPartitionRows = 8192;  // Строк build в разделе: хеш-таблица раздела помещается в кэш
+constexpr unsigned kMaxRadixBits = 12;
+constexpr size_t kPartitionChunkRows = 16384; // Наименьшая порция строк одного потока при разбиении
+constexpr uint64_t kHashMultiplier = 0x9E3779B97F4A7C15ull; // Перемешивает биты: std::hash<int> не меняет значение
+
+// Вход соединения, разбитый по старшим битам хеша ключа
+struct RadixPartitions {
+    std::vector<size_t> rows;    // Номера строк по разделам; внутри раздела - в исходном порядке
+    std::vector<size_t> offsets; // Начало каждого раздела в rows и конец последнего
+};
+
+/**
+ * @brief Параллельное разбиение строк по 2^bits разделам.
+ * Порции строк сначала считают размеры своих частей разделов, затем по префиксным суммам
+ * каждая порция записывает строки в свои места без синхронизации.
+ */
+template <typename Getter>
+RadixPartitions radix_partition(const Column& key, const std::vector<size_t>& rows, Getter get, unsigned bits) {
+    using Key = decltype(get(key, 0));
+    ThreadPool& pool = ThreadPool::shared();
+    size_t partition_count = size_t(1) << bits;
+    size_t chunk_rows = std::max(kPartitionChunkRows, (rows.size() + pool.size() * 4 - 1) / (pool.size() * 4));
+    size_t chunk_count = (rows.size() + chunk_rows - 1) / chunk_rows;
+
+    std::vector<uint16_t> partition_of(rows.size());
+    std::vector<size_t> positions(chunk_count * partition_count, 0);
+    pool.parallel_for(chunk_count, [&](size_t chunk) {
+        size_t* counts = &positions[chunk * partition_count];
+        size_t end = std::min(rows.size(), (chunk + 1) * chunk_rows);
+        for (size_t i = chunk * chunk_rows; i < end; ++i) {
+            uint64_t hash = static_cast<uint64_t>(std::hash<Key>()(get(key, rows[i]))) * kHashMultiplier;
+            partition_of[i] = static_cast<uint16_t>(hash >> (64 - bits));
+            ++counts[partition_of[i]];
+        }
+    });
+
+    // Раздел за разделом, внутри раздела - порции по порядку: строки раздела остаются по возрастанию
+    RadixPartitions result;
+    result.offsets.resize(partition_count + 1);
+    size_t position = 0;
+    for (size_t partition = 0; partition < partition_count; ++partition) {
+        result.offsets[partition] = position;
+        for (size_t chunk = 0; chunk < chunk_count; ++chunk) {
+            size_t count = positions[chunk * partition_count + partition];
+            positions[chunk * partition_count + partition] = position;
+            position += count;
+        }
+    }
+    result.offsets[partition_count] = position;
+
+    result.rows.resize(rows.size());
+    pool.parallel_for(chunk_count, [&](size_t chunk) {
+        size_t* cursors = &positions[chunk * partition_count];
+        size_t end = std::min(rows.size(), (chunk + 1) * chunk_rows);
+        for (size_t i = chunk * chunk_rows; i < end; ++i) {
+            result.rows[cursors[partition_of[i]]++] = rows[i];
+        }
+    });
+    return result;
+}
+
+/**
+ * @brief Параллельное хеш-соединение с разбиением (radix join).
+ * Оба входа разбиваются по одним и тем же битам хеша ключа, поэтому совпадения есть только
+ * у разделов с одинаковым номером. Пары разделов соединяются независимо на потоках пула,
+ * а хеш-таблица раздела мала и помещается в кэш. Небольшие входы соединяются без разбиения.
+ * @param matches Пары (строка build, строка probe) в порядке разделов.
+ */
+template <typename Getter>
+void radix_hash_join_rows(const Column& build_key, const std::vector<size_t>& build_rows,
+    const Column& probe_key, const std::vector<size_t>& probe_rows,
+    Getter get, std::vector<std::pair<size_t, size_t>>& matches) {
+    if (build_rows.size() + probe_rows.size() < kParallelJoinRows) {
+        hash_join_rows(build_key, RowRange(build_rows), probe_key, RowRange(probe_rows), get, matches);
+        return;
+    }
+
+    ThreadPool& pool = ThreadPool::shared();
+    size_t wanted_partitions = std::max(build_rows.size() / kRadixPartitionRows, pool.size() * 4);
+    unsigned bits = 1;
+    while ((size_t(1) << bits) < wanted_partitions && bits < kMaxRadixBits) {
+        ++bits;
+    }
+    RadixPartitions build = radix_partition(build_key, build_rows, get, bits);
+    RadixPartitions probe = radix_partition(probe_key, probe_rows, get, bits);
+
+    size_t partition_count = size_t(1) << bits;
+    std::vector<std::vector<std::pair<size_t, size_t>>> partition_matches(partition_count);
+    pool.parallel_for(partition_count, [&](size_t partition) {
+        hash_join_rows(build_key, RowRange(build.rows, build.offsets[partition], build.offsets[partition + 1]),
+            probe_key, RowRange(probe.rows, probe.offsets[partition], probe.offsets[partition + 1]),
+            get, partition_matches[partition]);
+    });
+
+    size_t total = matches.size();
+    for (const auto& part : partition_matches) {
+        total += part.size();
+    }
+    matches.reserve(total);
+    for (const auto& part : partition_matches) {
+        matches.insert(matches.end(), part.begin(), part.end());
+    }
+}
+
+/**
+ * @brief Сортировка частями на потоках пула с последующими попарными слияниями.
+ * Небольшие массивы сортируются на месте одним потоком.
+ */
+template <typename T>
+void parallel_sort(std::vector<T>& values) {
+    ThreadPool& pool = ThreadPool::shared();
+    if (values.size() < kParallelJoinRows || pool.size() < 2) {
+        std::sort(values.begin(), values.end());
+        return;
+    }
+    size_t part_count = 2;
+    while (part_count < pool.size()) {
+        part_count *= 2;
+    }
+    std::vector<size_t> bounds(part_count + 1);
+    for (size_t i = 0; i <= part_count; ++i) {
+        bounds[i] = values.size() * i / part_count;
+    }
+    pool.parallel_for(part_count, [&](size_t part) {
+        std::sort(values.begin() + bounds[part], values.begin() + bounds[part + 1]);
+    });
+
+    std::vector<T> merged(values.size());
+    for (size_t width = 1; width < part_count; width *= 2) {
+        pool.parallel_for(part_count / (2 * width), [&](size_t pair) {
+            size_t begin = bounds[2 * width * pair];
+            size_t middle = bounds[2 * width * pair + width];
+            size_t end = bounds[2 * width * (pair + 1)];
+            std::merge(values.begin() + begin, values.begin() + middle, values.begin() + middle, values.begin() + end,
+                merged.begin() + begin);
+        });
+        values.swap(merged);
+    }
+}
+
+/**
+ * @brief Соединение слиянием по двум упорядоченным индексам.
+ * Оба индекса проходятся один раз в порядке возрастания ключа.
+ * @param matches Пары (строка left, строка right).
+ */
+void merge_join_rows(const OrderedUnorderedIndex& left, const OrderedUnorderedIndex& right,
+    std::vector<std::pair<size_t, size_t>>& matches) {
+    auto left_it = left.entries().begin();
+    auto right_it = right.entries().begin();
+    while (left_it != left.entries().end() && right_it != right.entries().end()) {
+        if (compare_any_order(left_it->first, right_it->first)) {
+            ++left_it;
+        }
+        else if (compare_any_order(right_it->first, left_it->first)) {
+            ++right_it;
+        }
+        else {
+            for (size_t left_row : left_it->second) {
+                for (size_t right_row : right_it->second) {
+                    matches.emplace_back(left_row, right_row);
+                }
+            }
+            ++left_it;
+            ++right_it;
+        }
+    }
+}
+
+/**
+ * @brief Соединение вложенным циклом по индексу внутренней таблицы.
+ * Для каждой строки внешней таблицы совпадения берутся из хеш-индекса, без построения новой хеш-таблицы.
+ * @param matches Пары (строка outer, строка inner).
+ */
+void index_nested_loop_rows(const Column& outer_key, const std::vector<size_t>& outer_rows,
+    const UnorderedIndex& inner_index, std::vector<std::pair<size_t, size_t>>& matches) {
+    for (size_t outer_row : outer_rows) {
+        for (size_t inner_row : inner_index.lookup(outer_key.get(outer_row))) {
+            matches.emplace_back(outer_row, inner_row);
+        }
+    }
+}
+
+} // namespace
+
+// Видимые строки с непустым значением в столбце
+std::vector<size_t> Table::non_null_rows(size_t col_index, const Transaction* txn) const {
+    const Column& column = data[col_index];
+    size_t morsels = (row_count + kMorselRows - 1) / kMorselRows;
+    std::vector<std::vector<size_t>> parts(morsels);
+    ThreadPool::shared().parallel_for(morsels, [&](size_t morsel) {
+        size_t end = std::min(row_count, (morsel + 1) * kMorselRows);
+        for (size_t row = morsel * kMorselRows; row < end; ++row) {
+            if (is_visible(row, txn) && !column.is_null(row)) {
+                parts[morsel].push_back(row);
+            }
+        }
+    });
+
+    std::vector<size_t> result;
+    result.reserve(live_rows);
+    for (const auto& part : parts) {
+        result.insert(result.end(), part.begin(), part.end());
+    }
+    return result;
+}
+
+Table Table::join(const Table& other, const std::string& on_this_field, const std::string& on_other_field,
+    const Transaction* txn) const {
     size_t this_col_index = get_column_index(on_this_field);
     size_t other_col_index = other.get_column_index(on_other_field);
 
@@ -282,113 +1022,234 @@ Table Table::join(const Table& other, const std::string& on_this_field, const st
 
     Table result(result_schema);
 
-    for (const auto& row : rows) {
-        for (const auto& other_row : other.rows) {
-            if (row[this_col_index].type() == other_row[other_col_index].type()) {
-                bool match = false;
-                if (row[this_col_index].type() == typeid(int)) {
-                    match = (std::any_cast<int>(row[this_col_index]) == std::any_cast<int>(other_row[other_col_index]));
-                }
-                else if (row[this_col_index].type() == typeid(std::string)) {
-                    match = (std::any_cast<std::string>(row[this_col_index]) == std::any_cast<std::string>(other_row[other_col_index]));
-                }
-                else if (row[this_col_index].type() == typeid(bool)) {
-                    match = (std::any_cast<bool>(row[this_col_index]) == std::any_cast<bool>(other_row[other_col_index]));
-                }
-                else {
-                    throw std::runtime_error("Unsupported type for JOIN condition.");
-                }
+    const Column& this_key = data[this_col_index];
+    const Column& other_key = other.data[other_col_index];
+    if (this_key.type() != other_key.type()) {
+        return result; // Значения разных типов не совпадают
+    }
 
-                if (match) {
-                    std::map<std::string, std::any> combined_row;
-                    for (size_t i = 0; i < columns.size(); ++i) {
-                        combined_row[columns[i]] = row[i];
-                    }
-                    for (size_t i = 0; i < other.columns.size(); ++i) {
-                        std::string col_name = other.columns[i];
-                        if (combined_row.find(col_name) != combined_row.end()) {
-                            col_name = "other_" + col_name;
-                        }
-                        combined_row[col_name] = other_row[i];
-                    }
-                    result.insert(combined_row);
-                }
+    std::vector<size_t> this_rows = non_null_rows(this_col_index, txn);
+    std::vector<size_t> other_rows = other.non_null_rows(other_col_index, txn);
+    std::vector<std::pair<size_t, size_t>> matches; // (строка this, строка other)
+
+    // Выбор стратегии по имеющимся индексам и размерам таблиц
+    auto this_ordered = ordered_indices.find(on_this_field);
+    auto other_ordered = other.ordered_indices.find(on_other_field);
+    auto this_hash = indices.find(on_this_field);
+    auto other_hash = other.indices.find(on_other_field);
+    bool use_other_index = other_hash != other.indices.end() &&
+        (this_hash == indices.end() || this_rows.size() <= other_rows.size());
+
+    if (this_ordered != ordered_indices.end() && other_ordered != other.ordered_indices.end() &&
+        !this_ordered->second.is_mapped() && !other_ordered->second.is_mapped()) {
+        // Слияние по упорядоченным индексам (индексы, подключённые к файлу, идут по хеш-соединению)
+        merge_join_rows(this_ordered->second, other_ordered->second, matches);
+    }
+    else if (use_other_index) {
+        // Вложенный цикл по хеш-индексу other
+        index_nested_loop_rows(this_key, this_rows, other_hash->second, matches);
+    }
+    else if (this_hash != indices.end()) {
+        // Вложенный цикл по хеш-индексу этой таблицы
+        index_nested_loop_rows(other_key, other_rows, this_hash->second, matches);
+        for (auto& match : matches) {
+            std::swap(match.first, match.second);
+        }
+    }
+    else {
+        // Хеш-таблица строится по меньшему входу, больший вход её проверяет
+        bool build_this = this_rows.size() < other_rows.size();
+        const Column& build_key = build_this ? this_key : other_key;
+        const Column& probe_key = build_this ? other_key : this_key;
+        const auto& build_rows = build_this ? this_rows : other_rows;
+        const auto& probe_rows = build_this ? other_rows : this_rows;
+
+        switch (this_key.type()) {
+        case ColumnType::Int32:
+            radix_hash_join_rows(build_key, build_rows, probe_key, probe_rows,
+                [](const Column& column, size_t row) { return column.get_int(row); }, matches);
+            break;
+        case ColumnType::String:
+            radix_hash_join_rows(build_key, build_rows, probe_key, probe_rows,
+                [](const Column& column, size_t row) { return column.get_string(row); }, matches);
+            break;
+        case ColumnType::Bool:
+            radix_hash_join_rows(build_key, build_rows, probe_key, probe_rows,
+                [](const Column& column, size_t row) { return column.get_bool(row); }, matches);
+            break;
+        }
+        if (!build_this) {
+            for (auto& match : matches) {
+                std::swap(match.first, match.second);
             }
         }
     }
 
+    // Индексы содержат и версии, невидимые снимку
+    if (versioned || other.versioned) {
+        matches.erase(std::remove_if(matches.begin(), matches.end(), [&](const std::pair<size_t, size_t>& match) {
+            return !is_visible(match.first, txn) || !other.is_visible(match.second, txn);
+        }), matches.end());
+    }
+
+    // Результат в порядке вложенного цикла: по строкам this, затем по строкам other
+    parallel_sort(matches);
+
+    emit_join_rows(result, other, matches);
     return result;
 }
 
+// Запись результата соединения сразу в столбцы result, по одному столбцу за проход.
+// Столбцы результата независимы, поэтому заполняются параллельно.
+void Table::emit_join_rows(Table& result, const Table& other, const std::vector<std::pair<size_t, size_t>>& matches) const {
+    ThreadPool::shared().parallel_for(columns.size() + other.columns.size(), [&](size_t i) {
+        bool from_this = i < columns.size();
+        const Table& source = from_this ? *this : other;
+        size_t source_index = from_this ? i : i - columns.size();
+        std::string col_name = source.columns[source_index];
+        if (!from_this && column_types.find(col_name) != column_types.end()) {
+            col_name = "other_" + col_name;
+        }
+        Column& target = result.data[result.get_column_index(col_name)];
+        target.reserve(matches.size());
+        for (const auto& match : matches) {
+            target.append_from(source.data[source_index], from_this ? match.first : match.second);
+        }
+    });
+    result.deleted_rows.reserve((matches.size() + 63) / 64);
+    for (size_t i = 0; i < matches.size(); ++i) {
+        result.append_row_slot();
+    }
+    result.live_rows += matches.size();
+}
 
-void Table::update(const std::string& condition, const std::map<std::string, std::any>& updates) {
-    std::cout << "Updating rows with condition: " << condition << "\n";
-    auto condition_fn = parse_condition(condition);
 
-    for (auto& row : rows) {
-        //    map  
-        std::map<std::string, std::any> mapped_row;
-        for (size_t i = 0; i < columns.size(); ++i) {
-            mapped_row[columns[i]] = row[i];
+void Table::update(const std::string& condition, const std::map<std::string, std::any>& updates, Transaction* txn) {
+    update(Condition::parse(condition), updates, txn);
+}
+
+void Table::update(const Condition& condition, const std::map<std::string, std::any>& updates, Transaction* txn) {
+    std::cout << "Updating rows with condition: " << condition.text() << "\n";
+    Predicate predicate = compile_condition(condition);
+
+    // Строки, удовлетворяющие условию, ищутся параллельно (find_rows), а изменения применяются
+    // в этом потоке по порядку строк: индексы и журнал транзакции не синхронизированы
+    std::vector<size_t> matched_rows = find_rows(predicate, txn);
+
+    // UNIQUE / PRIMARY KEY: новое значение не должно быть занято другой строкой.
+    // Такие столбцы всегда проиндексированы, поэтому хватает поиска по индексу.
+    for (const auto& [col_name, new_value] : updates) {
+        if (matched_rows.empty() || !new_value.has_value() || !is_unique_column(col_name)) {
+            continue;
         }
+        bool taken = matched_rows.size() > 1; // Одно значение получат несколько строк
+        if (!taken) {
+            IndexRows holders = indices.at(col_name).lookup(new_value);
+            taken = std::any_of(holders.begin(), holders.end(), [&](size_t holder) {
+                return holder != matched_rows.front() && holds_value(holder, txn);
+            });
+        }
+        if (taken) {
+            throw std::runtime_error("Unique constraint violation for column '" + col_name +
+                "'. Duplicate value detected: " + value_text(new_value) + ".");
+        }
+    }
 
-        //     
-        if (condition_fn(mapped_row)) {
-            std::cout << "Row matches condition. Updating...\n";
+    for (size_t row : matched_rows) {
+        std::cout << "Row matches condition. Updating...\n";
 
-            //   
-            for (const auto& [col_name, new_value] : updates) {
-                //   
-                auto it = std::find(columns.begin(), columns.end(), col_name);
-                if (it == columns.end()) {
-                    throw std::runtime_error("Column '" + col_name + "' not found for update.");
-                }
+        // В транзакции значения собираются в новую версию строки, старая версия остаётся для других снимков
+        std::vector<std::any> new_row;
+        if (txn) {
+            new_row.reserve(columns.size());
+            for (const auto& column : data) {
+                new_row.push_back(column.get(row));
+            }
+        }
 
-                size_t col_index = std::distance(columns.begin(), it);
-                const std::string& col_type = column_types.at(col_name);
+        // Обновление столбцов строки
+        for (const auto& [col_name, new_value] : updates) {
+            // Проверка существования колонки
+            auto it = std::find(columns.begin(), columns.end(), col_name);
+            if (it == columns.end()) {
+                throw std::runtime_error("Column '" + col_name + "' not found for update.");
+            }
 
-                try {
-                    //   NOT NULL
-                    if (constraints.find(col_name) != constraints.end() &&
-                        constraints[col_name] == "NOT NULL" &&
-                        !new_value.has_value()) {
-                        throw std::runtime_error("Column '" + col_name + "' cannot be NULL.");
+            size_t col_index = std::distance(columns.begin(), it);
+            const std::string& col_type = column_types.at(col_name);
+            auto hash_index = indices.find(col_name);
+            auto ordered_index = ordered_indices.find(col_name);
+            std::any old_value = data[col_index].get(row);
+            auto set_value = [&](const std::any& value) {
+                if (txn) {
+                    new_row[col_index] = value;
+                }
+                else {
+                    data[col_index].set(row, value);
+                    if (row < persisted_rows) {
+                        require_full_save(); // Значение в файле изменилось на месте
                     }
+                }
+            };
 
-                    //     
-                    if (!new_value.has_value()) {
-                        row[col_index] = std::any(); //  NULL
-                        std::cout << "Set column '" << col_name << "' to NULL.\n";
-                    }
-                    else if (col_type == "int32") {
-                        if (new_value.type() != typeid(int)) {
-                            throw std::runtime_error("Type mismatch: expected int32.");
-                        }
-                        row[col_index] = std::any_cast<int>(new_value);
-                        std::cout << "Updated column '" << col_name << "' to value: " << std::any_cast<int>(new_value) << "\n";
-                    }
-                    else if (col_type == "string") {
-                        if (new_value.type() != typeid(std::string)) {
-                            throw std::runtime_error("Type mismatch: expected string.");
-                        }
-                        row[col_index] = std::any_cast<std::string>(new_value);
-                        std::cout << "Updated column '" << col_name << "' to value: " << std::any_cast<std::string>(new_value) << "\n";
+            try {
+                // Проверка ограничения NOT NULL
+                if (is_not_null_column(col_name) && !new_value.has_value()) {
+                    throw std::runtime_error("Column '" + col_name + "' cannot be NULL.");
+                }
+
+                // Обновление значения с проверкой типа
+                if (!new_value.has_value()) {
+                    set_value(std::any()); // Установка NULL
+                    std::cout << "Set column '" << col_name << "' to NULL.\n";
+                }
+                else if (data[col_index].type() == ColumnType::Int32) {
+                    if (new_value.type() != typeid(int)) {
+                        throw std::runtime_error("Type mismatch: expected int32.");
                     }
-                    else if (col_type == "bool") {
-                        if (new_value.type() != typeid(bool)) {
-                            throw std::runtime_error("Type mismatch: expected bool.");
-                        }
-                        row[col_index] = std::any_cast<bool>(new_value);
-                        std::cout << "Updated column '" << col_name << "' to value: " << (std::any_cast<bool>(new_value) ? "true" : "false") << "\n";
+                    set_value(new_value);
+                    std::cout << "Updated column '" << col_name << "' to value: " << std::any_cast<int>(new_value) << "\n";
+                }
+                else if (data[col_index].type() == ColumnType::String) {
+                    if (new_value.type() != typeid(std::string)) {
+                        throw std::runtime_error("Type mismatch: expected string.");
                     }
-                    else {
-                        throw std::runtime_error("Unsupported column type: " + col_type);
+                    set_value(new_value);
+                    std::cout << "Updated column '" << col_name << "' to value: " << std::any_cast<std::string>(new_value) << "\n";
+                }
+                else if (data[col_index].type() == ColumnType::Bool) {
+                    if (new_value.type() != typeid(bool)) {
+                        throw std::runtime_error("Type mismatch: expected bool.");
                     }
+                    set_value(new_value);
+                    std::cout << "Updated column '" << col_name << "' to value: " << (std::any_cast<bool>(new_value) ? "true" : "false") << "\n";
                 }
-                catch (const std::exception& e) {
-                    throw std::runtime_error("Error updating column '" + col_name + "': " + e.what());
+                else {
+                    throw std::runtime_error("Unsupported column type: " + col_type);
                 }
             }
+            catch (const std::exception& e) {
+                throw std::runtime_error("Error updating column '" + col_name + "': " + e.what());
+            }
+
+            if (txn) {
+                continue; // Новая версия попадёт в индексы целиком
+            }
+
+            // Перенос записи индексов со старого значения на новое
+            if (old_value.has_value()) {
+                if (hash_index != indices.end()) hash_index->second.remove_entry(old_value, row);
+                if (ordered_index != ordered_indices.end()) ordered_index->second.remove_entry(old_value, row);
+            }
+            if (new_value.has_value()) {
+                if (hash_index != indices.end()) hash_index->second.add_entry(new_value, row);
+                if (ordered_index != ordered_indices.end()) ordered_index->second.add_entry(new_value, row);
+            }
+        }
+
+        if (txn) {
+            end_version(row, txn);
+            append_row(new_row, txn);
         }
     }
     std::cout << "Update completed.\n";
@@ -396,413 +1257,636 @@ void Table::update(const std::string& condition, const std::map<std::string, std
 
 
 
-void Table::remove(const std::string& condition) {
-    //  
-    auto condition_fn = parse_condition(condition);
+void Table::remove(const std::string& condition, Transaction* txn) {
+    remove(Condition::parse(condition), txn);
+}
 
-    // -   
-    auto match_condition = [&](const std::vector<std::any>& row) {
-        std::map<std::string, std::any> mapped_row;
-        for (size_t i = 0; i < columns.size(); ++i) {
-            mapped_row[columns[i]] = row[i];
-        }
-        try {
-            return condition_fn(mapped_row);
+void Table::remove(const Condition& condition, Transaction* txn) {
+    // Компилируем условие
+    Predicate predicate = compile_condition(condition);
+
+    // Строки помечаются удалёнными, номера остальных строк не меняются.
+    // В транзакции завершается версия строки, освобождается она после того, как её перестанут видеть все снимки.
+    // Как и в update, поиск строк параллельный, а удаление идёт в этом потоке.
+    size_t removed_count = 0;
+    for (size_t row : find_rows(predicate, txn)) {
+        if (txn) {
+            end_version(row, txn);
         }
-        catch (const std::exception& e) {
-            throw std::runtime_error("Error evaluating condition: " + std::string(e.what()));
+        else {
+            unindex_row(row);
+            mark_deleted(row);
+            --live_rows;
         }
-        };
-
-    //    
-    size_t initial_size = rows.size();
-
-    //  ,   
-    auto new_end = std::remove_if(rows.begin(), rows.end(), match_condition);
-    size_t removed_count = std::distance(new_end, rows.end());
-    rows.erase(new_end, rows.end());
+        ++removed_count;
+    }
 
-    //  
+    // Логируем результат
     if (removed_count > 0) {
-        std::cout << "Removed " << removed_count << " row(s) matching condition: " << condition << "\n";
+        std::cout << "Removed " << removed_count << " row(s) matching condition: " << condition.text() << "\n";
     }
     else {
-        std::cout << "No rows matched the condition: " << condition << "\n";
+        std::cout << "No rows matched the condition: " << condition.text() << "\n";
     }
 
-    //   
-    if (rows.size() >= initial_size) {
+    // Проверка после удаления
+    if (removed_count == 0) {
         std::cerr << "Warning: No rows were removed, check the condition syntax.\n";
     }
 }
 
 
 
-void Table::create_index(const std::string& column) {
-    // ,    
+void Table::create_index(const std::string& column, Transaction* txn) {
+    // Проверяем, существует ли указанный столбец
     auto it = std::find(columns.begin(), columns.end(), column);
     if (it == columns.end()) {
         throw std::runtime_error("Column '" + column + "' not found.");
     }
 
-    // ,     
+    // Индекс UNIQUE / PRIMARY KEY существует, пока существует ограничение, поэтому CREATE INDEX
+    // ничего не меняет: ни откатывать в транзакции, ни удалять нечего
+    if (is_unique_column(column)) {
+        std::cout << "Index for column: " << column << " already maintained by " << constraints.at(column) << "\n";
+        return;
+    }
+
+    // Проверяем, что индекс ещё не существует
     if (indices.find(column) != indices.end()) {
         throw std::runtime_error("Index already exists for column '" + column + "'.");
     }
 
     size_t col_index = std::distance(columns.begin(), it);
 
-    //  try_emplace   
-    auto& unordered_index = indices.try_emplace(column).first->second;
-
-    //  
-    for (size_t i = 0; i < rows.size(); ++i) {
-        if (rows[i][col_index].has_value()) {
-            unordered_index.add_entry(rows[i][col_index], i);
-        }
+    indices[column] = build_hash_index(col_index);
+    require_full_save();
+    if (txn) {
+        txn->record_action([this, column]() { indices.erase(column); require_full_save(); });
     }
 
     std::cout << "Index created for column: " << column << "\n";
 }
 
-
-
-
-void Table::auto_index(const std::string& column) {
-    if (indices.find(column) == indices.end()) {
-        create_index(column);
-        std::cout << "Auto index created for column: " << column << "\n";
+UnorderedIndex Table::build_hash_index(size_t col_index) const {
+    UnorderedIndex index;
+    const Column& indexed_column = data[col_index];
+    for (size_t i = 0; i < row_count; ++i) {
+        if (!is_deleted(i) && !indexed_column.is_null(i)) {
+            index.add_entry(indexed_column.get(i), i);
+        }
     }
+    return index;
 }
 
+void Table::create_ordered_index(const std::string& column, Transaction* txn) {
+    size_t col_index = get_column_index(column);
 
+    // Проверяем, что индекс ещё не существует
+    if (ordered_indices.find(column) != ordered_indices.end()) {
+        throw std::runtime_error("Ordered index already exists for column '" + column + "'.");
+    }
 
-void Table::insert(const std::map<std::string, std::any>& values) {
-    std::vector<std::any> row(columns.size());
-
-    for (size_t i = 0; i < columns.size(); ++i) {
-        const auto& col_name = columns[i];
+    ordered_indices[column] = build_ordered_index(col_index);
+    require_full_save();
+    if (txn) {
+        txn->record_action([this, column]() { ordered_indices.erase(column); require_full_save(); });
+    }
 
-        //       
-        if (values.find(col_name) != values.end()) {
-            const auto& value = values.at(col_name);
+    std::cout << "Ordered index created for column: " << column << "\n";
+}
 
-            //   
-            std::cout << "Inserting value for column: " << col_name
-                << ", Value type: " << value.type().name() << std::endl;
+OrderedUnorderedIndex Table::build_ordered_index(size_t col_index) const {
+    OrderedUnorderedIndex index;
+    const Column& indexed_column = data[col_index];
+    for (size_t i = 0; i < row_count; ++i) {
+        if (!is_deleted(i) && !indexed_column.is_null(i)) {
+            index.add_entry(indexed_column.get(i), i);
+        }
+    }
+    return index;
+}
 
-            //    
-            const auto& expected_type = column_types.at(col_name);
-            if ((expected_type == "int32" && value.type() != typeid(int)) ||
-                (expected_type == "string" && value.type() != typeid(std::string)) ||
-                (expected_type == "bool" && value.type() != typeid(bool))) {
-                throw std::runtime_error("Type mismatch for column '" + col_name +
-                    "'. Expected: " + expected_type + ", got: " + value.type().name());
+// Добавление строки во все индексы таблицы
+void Table::index_rows(size_t begin, size_t end) {
+    for (auto& [column, index] : indices) {
+        const Column& indexed_column = data[get_column_index(column)];
+        for (size_t row = begin; row < end; ++row) {
+            if (!indexed_column.is_null(row)) {
+                index.add_entry(indexed_column.get(row), row);
             }
-
-            //   NOT NULL
-            if (constraints.find(col_name) != constraints.end() &&
-                constraints[col_name] == "NOT NULL" && !value.has_value()) {
-                throw std::runtime_error("Column '" + col_name + "' cannot be NULL. Expected type: " + expected_type);
+        }
+    }
+    for (auto& [column, index] : ordered_indices) {
+        const Column& indexed_column = data[get_column_index(column)];
+        for (size_t row = begin; row < end; ++row) {
+            if (!indexed_column.is_null(row)) {
+                index.add_entry(indexed_column.get(row), row);
             }
+        }
+    }
+}
 
-            //    
-            row[i] = value;
+// Удаление строки из всех индексов таблицы
+void Table::unindex_row(size_t row) {
+    for (auto& [column, index] : indices) {
+        const Column& indexed_column = data[get_column_index(column)];
+        if (!indexed_column.is_null(row)) {
+            index.remove_entry(indexed_column.get(row), row);
         }
-        else {
-            //  NULL-   
-            std::cout << "Inserting default (NULL) value for column: " << col_name << std::endl;
+    }
+    for (auto& [column, index] : ordered_indices) {
+        const Column& indexed_column = data[get_column_index(column)];
+        if (!indexed_column.is_null(row)) {
+            index.remove_entry(indexed_column.get(row), row);
+        }
+    }
+}
 
-            //   NOT NULL
-            if (constraints.find(col_name) != constraints.end() && constraints[col_name] == "NOT NULL") {
-                throw std::runtime_error("Column '" + col_name + "' cannot be NULL. Expected type: " + column_types[col_name]);
-            }
+// Новая позиция строки в конце таблицы (значения уже дописаны в столбцы).
+// live_rows учитывает вызывающий: строка транзакции учитывается при фиксации.
+void Table::append_row_slot() {
+    if ((row_count & 63) == 0) {
+        deleted_rows.push_back(0);
+    }
+    if (versioned) {
+        version_begin.push_back(0);
+        version_end.push_back(kInfinity);
+    }
+    ++row_count;
+}
 
-            row[i] = std::any(); //  NULL
-        }
+void Table::mark_deleted(size_t row) {
+    deleted_rows[row >> 6] |= uint64_t(1) << (row & 63);
+    touch_segment(row);
+}
+
+// Исключает из списка строки, невидимые транзакции
+void Table::drop_invisible(std::vector<size_t>& rows, const Transaction* txn) const {
+    if (!versioned && live_rows == row_count) {
+        return;
     }
+    rows.erase(std::remove_if(rows.begin(), rows.end(), [this, txn](size_t row) { return !is_visible(row, txn); }), rows.end());
+}
 
-    //    ( )
-    for (const auto& [col_name, constraint] : constraints) {
-        if (constraint == "UNIQUE") {
-            auto it = std::find(columns.begin(), columns.end(), col_name);
-            if (it != columns.end()) {
-                size_t col_index = std::distance(columns.begin(), it);
-                const auto& new_value = row[col_index];
-
-                for (const auto& existing_row : rows) {
-                    if (existing_row[col_index].has_value() && new_value.has_value()) {
-                        try {
-                            //      compare_any
-                            if (compare_any(existing_row[col_index], new_value)) {
-                                throw std::runtime_error("Unique constraint violation for column '" + col_name +
-                                    "'. Duplicate value detected.");
-                            }
-                        }
-                        catch (const std::bad_any_cast&) {
-                            throw std::runtime_error("Type mismatch during UNIQUE constraint check for column '" + col_name + "'.");
-                        }
-                    }
-                }
-            }
-        }
+// Версии строк заводятся при первом изменении в транзакции; существующие строки видны всем снимкам
+void Table::enable_versions() {
+    if (versioned) {
+        return;
     }
+    version_begin.assign(row_count, 0);
+    version_end.assign(row_count, kInfinity);
+    versioned = true;
+}
 
-    //    
-    rows.push_back(row);
-    std::cout << "Row inserted successfully.\n";
+// Дописывает строку; в транзакции она видна только ей до фиксации.
+// Освобождённая позиция занимается повторно, поэтому число позиций растёт с числом живых версий,
+// а не с историей изменений. Журнал WAL хранит номера позиций, поэтому redo_insert пишет на то же место.
+void Table::append_row(const std::vector<std::any>& row, Transaction* txn) {
+    if (txn) {
+        enable_versions();
+    }
+    size_t new_row;
+    if (!free_rows.empty()) {
+        new_row = free_rows.back();
+        free_rows.pop_back();
+        for (size_t i = 0; i < columns.size(); ++i) {
+            data[i].set(new_row, row[i]);
+        }
+        deleted_rows[new_row >> 6] &= ~(uint64_t(1) << (new_row & 63));
+        touch_segment(new_row);
+        if (versioned) {
+            version_begin[new_row] = 0;
+            version_end[new_row] = kInfinity;
+        }
+        if (new_row < persisted_rows) {
+            require_full_save(); // Значения позиции в файле изменились на месте
+        }
+    }
+    else {
+        for (size_t i = 0; i < columns.size(); ++i) {
+            data[i].append(row[i]);
+        }
+        append_row_slot();
+        new_row = row_count - 1;
+    }
+    if (txn) {
+        version_begin[new_row] = txn->stamp();
+        txn->record(this, new_row, UndoKind::Inserted);
+    }
+    else {
+        ++live_rows;
+    }
+    index_row(new_row);
 }
 
-std::shared_ptr<Table> Table::clone() const {
-    auto new_table = std::make_shared<Table>();
-    new_table->columns = this->columns;
-    new_table->column_types = this->column_types;
-    new_table->rows = this->rows;
-    new_table->indices = this->indices;
-    new_table->constraints = this->constraints;
-    return new_table;
+// Завершает версию строки в транзакции (первая записавшая транзакция выигрывает)
+void Table::end_version(size_t row, Transaction* txn) {
+    enable_versions();
+    if (version_end[row] != kInfinity) {
+        throw std::runtime_error("Write conflict: row was changed by a concurrent transaction.");
+    }
+    version_end[row] = txn->stamp();
+    txn->record(this, row, UndoKind::Deleted);
 }
 
-/**
- * @brief     :  , , .
- * @param condition   .
- * @return  ( , , ).
- */
-std::tuple<std::string, std::string, std::string> split_condition(const std::string& condition) {
-    static const std::regex condition_regex(R"((\w+)\s*(>=|<=|>|<|=)\s*([\w'"]+))");
-    std::smatch match;
+void Table::commit_write(size_t row, UndoKind kind, Timestamp commit_ts) {
+    touch_segment(row); // Видимость строки в последнем зафиксированном состоянии изменилась
+    if (kind == UndoKind::Inserted) {
+        version_begin[row] = commit_ts;
+        ++live_rows;
+    }
+    else {
+        version_end[row] = commit_ts;
+        --live_rows;
+        retired_rows.push_back(row);
+    }
+}
 
-    if (std::regex_match(condition, match, condition_regex)) {
-        return { match[1], match[2], match[3] };
+void Table::undo_write(size_t row, UndoKind kind) {
+    if (kind == UndoKind::Inserted) {
+        unindex_row(row);
+        mark_deleted(row);
+        free_rows.push_back(row); // Незафиксированную версию не видел никто, кроме отменённой транзакции
     }
     else {
-        throw std::runtime_error("Invalid condition format: " + condition);
+        version_end[row] = kInfinity;
+    }
+}
+
+void Table::collect_garbage(Timestamp oldest_read) {
+    // Версии завершались в порядке фиксации, поэтому освобождается начало очереди
+    while (!retired_rows.empty() && version_end[retired_rows.front()] <= oldest_read) {
+        size_t row = retired_rows.front();
+        retired_rows.pop_front();
+        unindex_row(row);
+        mark_deleted(row);
+        free_rows.push_back(row);
     }
 }
 
 
-/**
- * @brief   parse_condition.
- * @param condition   .
- * @return ,     .
- */
-std::function<bool(const std::map<std::string, std::any>&)> Table::parse_condition(const std::string& condition) const {
-    std::cout << "Parsing condition: " << condition << "\n";
-    std::string trimmed_condition = trim(condition);
 
-    //  "true"   true
-    if (trimmed_condition == "true") {
-        return [](const std::map<std::string, std::any>&) { return true; };
+
+void Table::write_row(size_t row, storage::ByteBuffer& out) const {
+    for (const auto& column : data) {
+        if (column.is_null(row)) {
+            out.put_u32(0);
+            continue;
+        }
+        out.put_u32(1);
+        switch (column.type()) {
+        case ColumnType::Int32:
+            out.put_u32(static_cast<uint32_t>(column.get_int(row)));
+            break;
+        case ColumnType::Bool:
+            out.put_u32(column.get_bool(row) ? 1 : 0);
+            break;
+        case ColumnType::String:
+            out.put_string(std::string(column.get_string(row)));
+            break;
+        }
     }
+}
 
-    //  "false"   false
-    if (trimmed_condition == "false") {
-        return [](const std::map<std::string, std::any>&) { return false; };
+void Table::redo_insert(size_t row, storage::ByteCursor& in) {
+    std::vector<std::any> values(data.size());
+    for (size_t i = 0; i < data.size(); ++i) {
+        if (in.get_u32() == 0) {
+            continue;
+        }
+        switch (data[i].type()) {
+        case ColumnType::Int32:
+            values[i] = static_cast<int>(in.get_u32());
+            break;
+        case ColumnType::Bool:
+            values[i] = in.get_u32() != 0;
+            break;
+        case ColumnType::String:
+            values[i] = in.get_string();
+            break;
+        }
     }
 
-    //    "AND"  "OR"
-    if (trimmed_condition.find(" AND ") != std::string::npos) {
-        size_t pos = trimmed_condition.find(" AND ");
-        std::string left = trim(trimmed_condition.substr(0, pos));
-        std::string right = trim(trimmed_condition.substr(pos + 5));
-        auto left_condition = parse_condition(left);
-        auto right_condition = parse_condition(right);
-        return [left_condition, right_condition](const std::map<std::string, std::any>& row) {
-            return left_condition(row) && right_condition(row);
-            };
+    if (row < row_count) {
+        // Позиция занята строкой, которая при сохранении базы ещё не была зафиксирована
+        if (!is_deleted(row)) {
+            throw std::runtime_error("Corrupted write-ahead log: row is already present.");
+        }
+        for (size_t i = 0; i < data.size(); ++i) {
+            data[i].set(row, values[i]);
+        }
+        deleted_rows[row >> 6] &= ~(uint64_t(1) << (row & 63));
+        if (row < persisted_rows) {
+            require_full_save();
+        }
+    }
+    else {
+        // Позиции откатившихся транзакций между ними остаются удалёнными
+        while (row_count < row) {
+            for (auto& column : data) {
+                column.append_null();
+            }
+            append_row_slot();
+            mark_deleted(row_count - 1);
+        }
+        for (size_t i = 0; i < data.size(); ++i) {
+            data[i].append(values[i]);
+        }
+        append_row_slot();
     }
+    ++live_rows;
+    index_row(row);
+}
 
-    if (trimmed_condition.find(" OR ") != std::string::npos) {
-        size_t pos = trimmed_condition.find(" OR ");
-        std::string left = trim(trimmed_condition.substr(0, pos));
-        std::string right = trim(trimmed_condition.substr(pos + 4));
-        auto left_condition = parse_condition(left);
-        auto right_condition = parse_condition(right);
-        return [left_condition, right_condition](const std::map<std::string, std::any>& row) {
-            return left_condition(row) || right_condition(row);
-            };
+void Table::redo_delete(size_t row) {
+    if (row >= row_count || is_deleted(row)) {
+        throw std::runtime_error("Corrupted write-ahead log: deleted row does not exist.");
     }
+    unindex_row(row);
+    mark_deleted(row);
+    --live_rows;
+}
+
+void Table::auto_index(const std::string& column) {
+    if (indices.find(column) == indices.end()) {
+        create_index(column);
+        std::cout << "Auto index created for column: " << column << "\n";
+    }
+}
+
+
+
+void Table::insert(const std::map<std::string, std::any>& values, Transaction* txn) {
+    // Значения для столбцов, которых нет в таблице, пропускаются
+    std::vector<std::any> row(columns.size());
+    for (size_t i = 0; i < columns.size(); ++i) {
+        auto value = values.find(columns[i]);
+        if (value != values.end()) {
+            row[i] = value->second;
+        }
+    }
+    insert_batch(columns, { std::move(row) }, txn);
+}
 
-    //   
-    auto [col_name, op, col_value] = split_condition(trimmed_condition);
+void Table::insert_batch(const std::vector<std::string>& column_names, const std::vector<std::vector<std::any>>& rows,
+    Transaction* txn) {
+    // Позиция значения столбца таблицы в строках пакета
+    constexpr size_t kMissing = static_cast<size_t>(-1);
+    std::vector<size_t> source(columns.size(), kMissing);
+    for (size_t j = 0; j < column_names.size(); ++j) {
+        size_t col_index = get_column_index(column_names[j]);
+        if (source[col_index] != kMissing) {
+            throw std::runtime_error("Column '" + column_names[j] + "' is specified more than once in INSERT.");
+        }
+        source[col_index] = j;
+    }
+    for (const auto& row : rows) {
+        if (row.size() != column_names.size()) {
+            throw std::runtime_error("INSERT row has " + std::to_string(row.size()) + " values, expected " +
+                std::to_string(column_names.size()) + ".");
+        }
+    }
+    if (rows.empty()) {
+        return;
+    }
 
-    //   
-    if (col_value == "true" || col_value == "false") {
-        bool bool_value = (col_value == "true");
-        return [col_name, bool_value](const std::map<std::string, std::any>& row) {
-            auto it = row.find(col_name);
-            if (it == row.end()) {
-                throw std::runtime_error("Column '" + col_name + "' not found.");
+    // Проверка по столбцам: тип, NOT NULL, UNIQUE
+    std::vector<std::any> column_values;
+    for (size_t i = 0; i < columns.size(); ++i) {
+        const auto& col_name = columns[i];
+        const auto& expected_type = column_types.at(col_name);
+        bool not_null = is_not_null_column(col_name);
+        if (source[i] == kMissing) {
+            if (not_null) {
+                throw std::runtime_error("Column '" + col_name + "' cannot be NULL. Expected type: " + expected_type);
+            }
+            continue;
+        }
+        for (const auto& row : rows) {
+            const auto& value = row[source[i]];
+            if (!data[i].accepts(value)) {
+                throw std::runtime_error("Type mismatch for column '" + col_name +
+                    "'. Expected: " + expected_type + ", got: " + value.type().name());
             }
-            if (it->second.type() != typeid(bool)) {
-                throw std::runtime_error("Type mismatch for column '" + col_name + "', expected bool.");
+            if (not_null && !value.has_value()) {
+                throw std::runtime_error("Column '" + col_name + "' cannot be NULL. Expected type: " + expected_type);
             }
-            return std::any_cast<bool>(it->second) == bool_value;
-            };
+        }
+        if (is_unique_column(col_name)) {
+            // Столбец проиндексирован, поэтому проверка стоит O(1) на строку пакета
+            column_values.clear();
+            column_values.reserve(rows.size());
+            for (const auto& row : rows) {
+                column_values.push_back(row[source[i]]);
+            }
+            size_t duplicate = find_duplicate(col_name, column_values, txn);
+            if (duplicate != kNoDuplicate) {
+                throw std::runtime_error("Unique constraint violation for column '" + col_name +
+                    "'. Duplicate value detected: " + value_text(column_values[duplicate]) + ".");
+            }
+        }
     }
 
-    //   
-    if (col_value[0] == '\'' && col_value.back() == '\'') {
-        std::string str_value = col_value.substr(1, col_value.size() - 2); //  
-        if (op == "=") {
-            return [col_name, str_value](const std::map<std::string, std::any>& row) {
-                auto it = row.find(col_name);
-                if (it == row.end()) {
-                    throw std::runtime_error("Column '" + col_name + "' not found.");
-                }
-                if (it->second.type() != typeid(std::string)) {
-                    throw std::runtime_error("Type mismatch for column '" + col_name + "', expected string.");
-                }
-                return std::any_cast<std::string>(it->second) == str_value;
-                };
+    // Добавление строк: значения уже проверены, дописываем их по столбцам.
+    // Память резервируется, только если пакет больше таблицы, иначе рост векторов и так амортизирован.
+    if (txn) {
+        enable_versions();
+    }
+    size_t first_row = row_count;
+    size_t new_rows = row_count + rows.size();
+    bool grow = rows.size() > row_count;
+    for (size_t i = 0; i < columns.size(); ++i) {
+        Column& column = data[i];
+        if (grow) {
+            column.reserve(new_rows);
         }
-        else {
-            throw std::runtime_error("Unsupported operator for string column: " + op);
+        if (source[i] == kMissing) {
+            for (size_t r = 0; r < rows.size(); ++r) {
+                column.append_null();
+            }
+            continue;
+        }
+        for (const auto& row : rows) {
+            column.append(row[source[i]]);
         }
     }
-
-    //   
-    if (is_numeric(col_value)) {
-        int int_value = std::stoi(col_value);
-        if (op == "=") {
-            return [col_name, int_value](const std::map<std::string, std::any>& row) {
-                auto it = row.find(col_name);
-                if (it == row.end()) {
-                    throw std::runtime_error("Column '" + col_name + "' not found.");
-                }
-                if (it->second.type() != typeid(int)) {
-                    throw std::runtime_error("Type mismatch for column '" + col_name + "', expected int.");
-                }
-                return std::any_cast<int>(it->second) == int_value;
-                };
-        }
-        else if (op == ">=") {
-            return [col_name, int_value](const std::map<std::string, std::any>& row) {
-                auto it = row.find(col_name);
-                if (it == row.end()) {
-                    throw std::runtime_error("Column '" + col_name + "' not found.");
-                }
-                if (it->second.type() != typeid(int)) {
-                    throw std::runtime_error("Type mismatch for column '" + col_name + "', expected int.");
-                }
-                return std::any_cast<int>(it->second) >= int_value;
-                };
-        }
-        else if (op == "<=") {
-            return [col_name, int_value](const std::map<std::string, std::any>& row) {
-                auto it = row.find(col_name);
-                if (it == row.end()) {
-                    throw std::runtime_error("Column '" + col_name + "' not found.");
-                }
-                if (it->second.type() != typeid(int)) {
-                    throw std::runtime_error("Type mismatch for column '" + col_name + "', expected int.");
-                }
-                return std::any_cast<int>(it->second) <= int_value;
-                };
-        }
-        else if (op == ">") {
-            return [col_name, int_value](const std::map<std::string, std::any>& row) {
-                auto it = row.find(col_name);
-                if (it == row.end()) {
-                    throw std::runtime_error("Column '" + col_name + "' not found.");
-                }
-                if (it->second.type() != typeid(int)) {
-                    throw std::runtime_error("Type mismatch for column '" + col_name + "', expected int.");
-                }
-                return std::any_cast<int>(it->second) > int_value;
-                };
-        }
-        else if (op == "<") {
-            return [col_name, int_value](const std::map<std::string, std::any>& row) {
-                auto it = row.find(col_name);
-                if (it == row.end()) {
-                    throw std::runtime_error("Column '" + col_name + "' not found.");
-                }
-                if (it->second.type() != typeid(int)) {
-                    throw std::runtime_error("Type mismatch for column '" + col_name + "', expected int.");
-                }
-                return std::any_cast<int>(it->second) < int_value;
-                };
+    if (grow) {
+        deleted_rows.reserve((new_rows + 63) / 64);
+        if (versioned) {
+            version_begin.reserve(new_rows);
+            version_end.reserve(new_rows);
         }
-        else {
-            throw std::runtime_error("Unsupported operator in condition: " + op);
+    }
+    for (size_t r = 0; r < rows.size(); ++r) {
+        append_row_slot();
+    }
+    if (txn) {
+        for (size_t row = first_row; row < row_count; ++row) {
+            version_begin[row] = txn->stamp();
+            txn->record(this, row, UndoKind::Inserted);
         }
     }
+    else {
+        live_rows += rows.size();
+    }
+    index_rows(first_row, row_count);
+}
 
-    throw std::runtime_error("Unsupported value format in condition: " + condition);
+std::shared_ptr<Table> Table::clone() const {
+    auto new_table = std::make_shared<Table>();
+    new_table->columns = this->columns;
+    new_table->column_types = this->column_types;
+    new_table->data = this->data;
+    new_table->row_count = this->row_count;
+    new_table->indices = this->indices;
+    new_table->ordered_indices = this->ordered_indices;
+    new_table->live_rows = this->live_rows;
+    new_table->deleted_rows = this->deleted_rows;
+    new_table->versioned = this->versioned;
+    new_table->version_begin = this->version_begin;
+    new_table->version_end = this->version_end;
+    new_table->retired_rows = this->retired_rows;
+    new_table->free_rows = this->free_rows;
+    new_table->constraints = this->constraints;
+    new_table->change_stamp = this->change_stamp;
+    new_table->persisted_stamp = this->persisted_stamp;
+    new_table->full_save_stamp = this->full_save_stamp;
+    new_table->persisted_rows = this->persisted_rows;
+    new_table->segment_stamps = this->segment_stamps;
+    return new_table;
 }
 
+// Компиляция условия в дерево, привязанное к столбцам этой таблицы
+Predicate Table::compile_condition(const Condition& condition) const {
+    return Predicate::compile(condition, columns, data);
+}
 
+namespace {
 
-//   parse_simple_condition
-std::function<bool(const std::map<std::string, std::any>&)> Table::parse_simple_condition(const std::string& condition) const {
-    size_t equals_pos = condition.find('=');
-    if (equals_pos == std::string::npos) {
-        throw std::runtime_error("Syntax error in condition: " + condition);
+// Собирает узлы сравнения из цепочки AND, начиная с корня условия.
+void collect_conjuncts(const Predicate& predicate, size_t node_index, std::vector<size_t>& out) {
+    const auto& node = predicate.get_nodes()[node_index];
+    if (node.kind == Predicate::NodeKind::And) {
+        collect_conjuncts(predicate, node.left, out);
+        collect_conjuncts(predicate, node.right, out);
     }
+    else if (node.kind == Predicate::NodeKind::Compare) {
+        out.push_back(node_index);
+    }
+}
 
-    std::string col_name = trim(condition.substr(0, equals_pos));
-    std::string col_value = trim(condition.substr(equals_pos + 1));
-
-    if (col_name.empty()) {
-        throw std::runtime_error("Column name is empty in condition: " + condition);
+// Значение константы узла в виде ключа индекса.
+std::any node_key(const Predicate::Node& node) {
+    switch (node.type) {
+    case ColumnType::Int32:
+        return static_cast<int>(node.int_value);
+    case ColumnType::String:
+        return node.string_value;
+    case ColumnType::Bool:
+        return node.bool_value;
     }
+    return std::any();
+}
 
-    //   NULL
-    if (col_value.empty() || col_value == "NULL" || col_value == "null") {
-        return [col_name](const std::map<std::string, std::any>& row) {
-            auto it = row.find(col_name);
-            if (it == row.end()) {
-                return false;
-            }
-            return !it->second.has_value();
-            };
+} // namespace
+
+/**
+ * @brief Выбор строк по условию с использованием индексов.
+ * Равенство по столбцу с хеш-индексом даёт кандидатов за O(1),
+ * границы (>=, <=, <, >, =) по столбцу с упорядоченным индексом объединяются в один диапазон.
+ * Остальная часть условия проверяется только на кандидатах.
+ * @return Номера строк по возрастанию.
+ */
+std::vector<size_t> Table::find_rows(const Predicate& predicate, const Transaction* txn) const {
+    std::vector<size_t> rows;
+    if (find_indexed_rows(predicate, txn, rows)) {
+        return rows;
     }
+    return scan_rows(predicate, txn); // Полный проход
+}
 
-    //   
-    if (col_value[0] == '\'' && col_value.back() == '\'') {
-        col_value = col_value.substr(1, col_value.size() - 2);
-        return [col_name, col_value](const std::map<std::string, std::any>& row) {
-            auto it = row.find(col_name);
-            if (it == row.end()) {
-                return false;
-            }
-            if (it->second.type() != typeid(std::string)) {
-                return false;
-            }
-            return std::any_cast<std::string>(it->second) == col_value;
-            };
+bool Table::find_indexed_rows(const Predicate& predicate, const Transaction* txn, std::vector<size_t>& rows) const {
+    std::vector<size_t> conjuncts;
+    collect_conjuncts(predicate, predicate.get_root(), conjuncts);
+    const auto& nodes = predicate.get_nodes();
+
+    // 1. Равенство по хеш-индексу
+    for (size_t node_index : conjuncts) {
+        const auto& node = nodes[node_index];
+        if (node.op != CompareOp::Eq) {
+            continue;
+        }
+        auto index_it = indices.find(columns[node.column]);
+        if (index_it == indices.end()) {
+            continue;
+        }
+        rows = index_it->second.find(node_key(node));
+        std::sort(rows.begin(), rows.end());
+        drop_invisible(rows, txn); // Индекс содержит и версии, невидимые снимку
+        predicate.filter(data, rows);
+        return true;
     }
 
-    //   
-    if (col_value == "true" || col_value == "false") {
-        bool bool_value = (col_value == "true");
-        return [col_name, bool_value](const std::map<std::string, std::any>& row) {
-            auto it = row.find(col_name);
-            if (it == row.end()) {
-                return false;
+    // 2. Диапазон по упорядоченному индексу
+    for (size_t node_index : conjuncts) {
+        const auto& column_name = columns[nodes[node_index].column];
+        auto index_it = ordered_indices.find(column_name);
+        if (index_it == ordered_indices.end()) {
+            continue;
+        }
+
+        // Сужаем границы всеми сравнениями по этому столбцу
+        std::optional<IndexBound> lower, upper;
+        for (size_t other_index : conjuncts) {
+            const auto& node = nodes[other_index];
+            if (node.column != nodes[node_index].column) {
+                continue;
             }
-            if (it->second.type() != typeid(bool)) {
-                return false;
+            IndexBound bound{ node_key(node), node.op != CompareOp::Lt && node.op != CompareOp::Gt };
+            bool is_lower = node.op == CompareOp::Eq || node.op == CompareOp::Gt || node.op == CompareOp::Ge;
+            bool is_upper = node.op == CompareOp::Eq || node.op == CompareOp::Lt || node.op == CompareOp::Le;
+            if (is_lower && (!lower || compare_any_order(lower->value, bound.value) ||
+                (!compare_any_order(bound.value, lower->value) && !bound.inclusive))) {
+                lower = bound;
             }
-            return std::any_cast<bool>(it->second) == bool_value;
-            };
+            if (is_upper && (!upper || compare_any_order(bound.value, upper->value) ||
+                (!compare_any_order(upper->value, bound.value) && !bound.inclusive))) {
+                upper = bound;
+            }
+        }
+
+        rows = index_it->second.find_range(lower, upper);
+        drop_invisible(rows, txn);
+        predicate.filter(data, rows);
+        return true;
     }
+    return false;
+}
 
-    //   
-    if (is_numeric(col_value)) {
-        int int_value = std::stoi(col_value);
-        return [col_name, int_value](const std::map<std::string, std::any>& row) {
-            auto it = row.find(col_name);
-            if (it == row.end()) {
-                return false;
-            }
-            if (it->second.type() != typeid(int)) {
-                return false;
-            }
-            return std::any_cast<int>(it->second) == int_value;
-            };
+std::vector<size_t> Table::scan_rows(const Predicate& predicate, const Transaction* txn) const {
+    size_t morsels = (row_count + kMorselRows - 1) / kMorselRows;
+    if (morsels <= 1) {
+        std::vector<size_t> rows = predicate.select(data, 0, row_count);
+        drop_invisible(rows, txn);
+        return rows;
     }
 
-    throw std::runtime_error("Unsupported value format in condition: " + condition);
+    // Порции читают столбцы и версии строк только для чтения; вызывающий держит блокировку таблицы
+    std::vector<std::vector<size_t>> parts(morsels);
+    ThreadPool::shared().parallel_for(morsels, [&](size_t morsel) {
+        size_t begin = morsel * kMorselRows;
+        parts[morsel] = predicate.select(data, begin, std::min(row_count, begin + kMorselRows));
+        drop_invisible(parts[morsel], txn);
+    });
+
+    size_t total = 0;
+    for (const auto& part : parts) {
+        total += part.size();
+    }
+    std::vector<size_t> rows;
+    rows.reserve(total);
+    for (const auto& part : parts) {
+        rows.insert(rows.end(), part.begin(), part.end());
+    }
+    return rows;
 }
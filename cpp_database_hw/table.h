@@ -7,40 +7,182 @@
 #include <any>
 #include <functional>
 #include <memory>
+#include <deque>
 #include <iostream>
-#include "index.h" //   UnorderedIndex
+#include <shared_mutex>
+#include "index.h" // Подключаем реализацию UnorderedIndex
+#include "ordered_index.h"
+#include "column.h"
+#include "predicate.h"
+#include "transaction.h"
+#include "cursor.h"
 
+/**
+ * @class Table
+ * Строки хранятся версиями: изменение внутри транзакции (txn != nullptr) завершает старую версию
+ * и дописывает новую, чтение видит только версии своего снимка.
+ * Без транзакции изменения применяются сразу и видны всем, а чтение видит последнее зафиксированное состояние.
+ *
+ * Сама таблица не синхронизирована: при работе из нескольких потоков вызывающий держит mutex() -
+ * разделяемо для чтения, монопольно для изменения (это делают Database и QueryProcessor).
+ */
 class Table {
 public:
     Table(const std::map<std::string, std::string>& schema);
-    Table join(const Table& other, const std::string& on_this_field, const std::string& on_other_field) const;
+    Table join(const Table& other, const std::string& on_this_field, const std::string& on_other_field,
+        const Transaction* txn = nullptr) const;
     Table() = default;
 
-    void insert(const std::map<std::string, std::any>& values);
-    void remove(const std::string& condition);
-    void update(const std::string& condition, const std::map<std::string, std::any>& updates);
-    std::vector<std::map<std::string, std::any>> select(const std::string& condition) const;
-    bool is_unique(const std::string& column_name, const std::any& value) const;
+    void insert(const std::map<std::string, std::any>& values, Transaction* txn = nullptr);
+    // Пакетная вставка: значения каждой строки rows идут в порядке column_names, остальные столбцы - NULL.
+    // Пакет проверяется по столбцам и добавляется целиком или не добавляется совсем.
+    void insert_batch(const std::vector<std::string>& column_names, const std::vector<std::vector<std::any>>& rows,
+        Transaction* txn = nullptr);
+    void remove(const std::string& condition, Transaction* txn = nullptr);
+    void update(const std::string& condition, const std::map<std::string, std::any>& updates, Transaction* txn = nullptr);
+    std::vector<std::map<std::string, std::any>> select(const std::string& condition, const Transaction* txn = nullptr) const;
+    // То же для условия, уже разобранного запросом
+    void remove(const Condition& condition, Transaction* txn = nullptr);
+    void update(const Condition& condition, const std::map<std::string, std::any>& updates, Transaction* txn = nullptr);
+    std::vector<std::map<std::string, std::any>> select(const Condition& condition, const Transaction* txn = nullptr) const;
+    // Потоковый проход без сборки результата (см. Cursor); таблицу держит заблокированной вызывающий
+    Cursor scan(const std::string& condition, const Transaction* txn = nullptr) const;
+    Cursor scan(const Condition& condition, const Transaction* txn = nullptr) const;
+    // Ограничение столбца пустой таблицы: "PRIMARY KEY", "UNIQUE" или "NOT NULL".
+    // Для UNIQUE и PRIMARY KEY создаётся хеш-индекс, по нему проверяется уникальность.
+    void add_constraint(const std::string& column, const std::string& constraint);
+    bool is_unique_column(const std::string& column) const; // UNIQUE или PRIMARY KEY
+    bool is_unique(const std::string& column_name, const std::any& value, const Transaction* txn = nullptr) const;
+    // Номер первого значения values, которое уже занято в столбце или повторяет предыдущее значение values;
+    // kNoDuplicate, если все значения уникальны. NULL и значения другого типа ничего не занимают.
+    static constexpr size_t kNoDuplicate = static_cast<size_t>(-1);
+    size_t find_duplicate(const std::string& column_name, const std::vector<std::any>& values, const Transaction* txn = nullptr) const;
 
-    void create_index(const std::string& column);
+    // Вызываются транзакцией при фиксации и откате
+    void commit_write(size_t row, UndoKind kind, Timestamp commit_ts);
+    void undo_write(size_t row, UndoKind kind);
+    // Освобождает версии, завершённые не позже oldest_read: их уже не видит ни один снимок
+    void collect_garbage(Timestamp oldest_read);
+
+    // Журнал WAL: значения строки при фиксации и повторное применение изменений при открытии базы.
+    // Строка восстанавливается на прежней позиции, чтобы следующие записи журнала ссылались на неё.
+    void write_row(size_t row, storage::ByteBuffer& out) const;
+    void redo_insert(size_t row, storage::ByteCursor& in);
+    void redo_delete(size_t row);
+
+    // Инкрементальная контрольная точка: изменения после последней записи таблицы в файл.
+    // Блок изменений содержит дописанные строки и битовую карту удалённых строк изменённых сегментов.
+    bool needs_full_save() const { return full_save_stamp > persisted_stamp; }
+    bool has_unsaved_changes() const;
+    void save_changes(storage::BinaryWriter& out) const;
+    void load_changes(storage::MemoryReader& in); // После load / attach, по порядку записи
+    struct SaveMark {
+        uint64_t rows = 0;
+        uint64_t stamp = 0;
+    };
+    SaveMark save_mark() const { return { row_count, change_stamp }; } // Состояние, которое записывается в файл
+    void mark_persisted(const SaveMark& mark);                         // Это состояние уже в файле
+
+    // В транзакции создание индекса отменяется при откате
+    void create_index(const std::string& column, Transaction* txn = nullptr);
+    void create_ordered_index(const std::string& column, Transaction* txn = nullptr);
     void auto_index(const std::string& column);
 
-    void save(std::ostream& os) const;
-    void load(std::istream& is);
+    void save(storage::BinaryWriter& out) const;
+    void load(storage::MemoryReader& in);
+    void load_text(std::istream& is); // Текстовый формат прежних версий
+    void attach(storage::MemoryReader& in, const std::shared_ptr<const storage::MappedFile>& file);
+    void detach();
     std::shared_ptr<Table> clone() const;
 
-    void print(std::ostream& os) const; //   print
-    size_t get_column_index(const std::string& column_name) const; //   get_column_index
+    void print(std::ostream& os) const; // Добавили метод print
+    size_t get_column_index(const std::string& column_name) const; // Добавили метод get_column_index
+    const std::vector<std::string>& column_names() const { return columns; } // Порядок столбцов для INSERT ... VALUES
+    size_t size() const { return live_rows; } // Количество строк в последнем зафиксированном состоянии
+
+    std::shared_mutex& mutex() const { return *access; }
 
 private:
+    friend class Cursor;
+
+    std::unique_ptr<std::shared_mutex> access = std::make_unique<std::shared_mutex>();
     std::vector<std::string> columns;
     std::map<std::string, std::string> column_types;
-    std::vector<std::vector<std::any>> rows;
-    std::map<std::string, UnorderedIndex> indices; //  UnorderedIndex  index.h
+    std::vector<Column> data; // Колоночное хранилище, по одному Column на каждый элемент columns
+    size_t row_count = 0; // Количество позиций строк, включая удалённые
+    size_t live_rows = 0;
+    std::vector<uint64_t> deleted_rows; // Битовая карта удалённых строк
+    // Версии строк: создаются при первом изменении в транзакции, до этого все строки видны всем
+    bool versioned = false;
+    std::vector<Timestamp> version_begin;
+    std::vector<Timestamp> version_end;
+    std::deque<size_t> retired_rows; // Завершённые версии в порядке фиксации, ожидают освобождения
+    std::vector<size_t> free_rows;   // Позиции, которых не видит ни один снимок: их занимает append_row
+    std::map<std::string, UnorderedIndex> indices; // Используем UnorderedIndex из index.h
+    std::map<std::string, OrderedUnorderedIndex> ordered_indices; // Упорядоченные индексы для диапазонных условий
     std::map<std::string, std::string> constraints;
 
-    std::function<bool(const std::map<std::string, std::any>&)> parse_condition(const std::string& condition) const;
-    std::function<bool(const std::map<std::string, std::any>&)> parse_simple_condition(const std::string& condition) const;
+    // Отметки изменений - значения счётчика change_stamp; всё, что новее persisted_stamp, ещё не в файле
+    static constexpr size_t kSegmentRows = 65536;
+    uint64_t change_stamp = 1;
+    uint64_t persisted_stamp = 0;
+    uint64_t full_save_stamp = 1;          // Изменение схемы, индексов или записанных значений
+    uint64_t persisted_rows = 0;           // Строки, уже записанные в файл
+    std::vector<uint64_t> segment_stamps;  // Изменение видимости строк по сегментам kSegmentRows
+    void touch_segment(size_t row);
+    void require_full_save() { full_save_stamp = ++change_stamp; }
+    uint64_t saved_deleted_word(size_t word) const;
+
+    void add_column(const std::string& name, const std::string& type);
+    bool is_not_null_column(const std::string& column) const; // NOT NULL или PRIMARY KEY
+    std::map<std::string, std::any> row_to_map(size_t row) const;
+    // Столбцы индексов, записанные в схеме таблицы
+    struct IndexColumns {
+        std::vector<std::string> hash;
+        std::vector<std::string> ordered;
+        size_t stored_hash = 0; // Первые stored_hash хеш-индексов записаны в файл, остальные добавлены ограничениями
+    };
+    uint64_t read_schema(std::string_view schema_bytes, IndexColumns& index_columns);
+    void attach_indices(storage::MemoryReader& in, const IndexColumns& index_columns,
+        const std::shared_ptr<const storage::MappedFile>& file, bool verify);
+    void rebuild_indices(const IndexColumns& index_columns);
+    UnorderedIndex build_hash_index(size_t col_index) const;
+    OrderedUnorderedIndex build_ordered_index(size_t col_index) const;
+    void set_deleted_rows(std::vector<uint64_t> deleted, uint64_t stored_rows);
+
+    Predicate compile_condition(const Condition& condition) const;
+    std::vector<size_t> find_rows(const Predicate& predicate, const Transaction* txn) const;
+    // Строки по хеш- или упорядоченному индексу; false, если условие индексы не использует
+    bool find_indexed_rows(const Predicate& predicate, const Transaction* txn, std::vector<size_t>& rows) const;
+    // Полный проход порциями по kMorselRows строк: порции разбирают потоки общего пула,
+    // результаты склеиваются по порядку порций
+    static constexpr size_t kMorselRows = 16384;
+    std::vector<size_t> scan_rows(const Predicate& predicate, const Transaction* txn) const;
+    bool is_deleted(size_t row) const { return (deleted_rows[row >> 6] >> (row & 63)) & 1; }
+    bool is_visible(size_t row, const Transaction* txn) const {
+        if (is_deleted(row)) return false;
+        if (!versioned) return true;
+        return txn ? txn->sees(version_begin[row], version_end[row])
+                   : version_visible(version_begin[row], version_end[row], kLatest, kUncommittedFlag);
+    }
+    void drop_invisible(std::vector<size_t>& rows, const Transaction* txn) const;
+    // Строка занимает своё значение для проверки уникальности: все незавершённые версии,
+    // в том числе незафиксированные версии других транзакций
+    bool holds_value(size_t row, const Transaction* txn) const {
+        if (is_deleted(row)) return false;
+        return !versioned || version_end[row] == kInfinity ||
+            (!is_committed(version_end[row]) && !(txn && version_end[row] == txn->stamp()));
+    }
+    void mark_deleted(size_t row);
+    void enable_versions();
+    void append_row(const std::vector<std::any>& row, Transaction* txn);
+    void end_version(size_t row, Transaction* txn);
+    void index_row(size_t row) { index_rows(row, row + 1); }
+    void index_rows(size_t begin, size_t end);
+    void unindex_row(size_t row);
+    void append_row_slot();
+    std::vector<size_t> non_null_rows(size_t col_index, const Transaction* txn) const;
+    void emit_join_rows(Table& result, const Table& other, const std::vector<std::pair<size_t, size_t>>& matches) const;
 };
 
 #endif // TABLE_H
@@ -0,0 +1,111 @@
+#include "thread_pool.h"
+#include <algorithm>
+#include <atomic>
+#include <exception>
+
+ThreadPool::ThreadPool(size_t thread_count) {
+    for (size_t i = 0; i < thread_count; ++i) {
+        workers.emplace_back([this]() { worker_loop(); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    task_ready.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+ThreadPool& ThreadPool::shared() {
+    static ThreadPool pool(std::max(1u, std::thread::hardware_concurrency()));
+    return pool;
+}
+
+void ThreadPool::enqueue(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        tasks.push_back(std::move(task));
+    }
+    task_ready.notify_one();
+}
+
+void ThreadPool::worker_loop() {
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            task_ready.wait(lock, [this]() { return stopping || !tasks.empty(); });
+            if (tasks.empty()) {
+                return; // stopping и очередь пуста
+            }
+            task = std::move(tasks.front());
+            tasks.pop_front();
+        }
+        task();
+    }
+}
+
+void ThreadPool::parallel_for(size_t count, const std::function<void(size_t)>& body) {
+    if (count == 0) {
+        return;
+    }
+    if (count == 1 || workers.empty()) {
+        for (size_t i = 0; i < count; ++i) {
+            body(i);
+        }
+        return;
+    }
+
+    // Состояние общее для вызывающего и помощников; помощник может запуститься уже после возврата
+    struct State {
+        std::atomic<size_t> next{ 0 };
+        size_t finished = 0;
+        size_t count = 0;
+        std::exception_ptr error;
+        std::mutex mutex;
+        std::condition_variable done;
+    };
+    auto state = std::make_shared<State>();
+    state->count = count;
+
+    auto run = [state, &body]() {
+        size_t processed = 0;
+        size_t i;
+        while ((i = state->next.fetch_add(1)) < state->count) {
+            try {
+                body(i);
+            }
+            catch (...) {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                if (!state->error) {
+                    state->error = std::current_exception();
+                }
+            }
+            ++processed;
+        }
+        if (processed > 0) {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            state->finished += processed;
+            if (state->finished == state->count) {
+                state->done.notify_all();
+            }
+        }
+    };
+
+    // body живёт до возврата, а после выдачи всех номеров помощники к нему не обращаются
+    size_t helpers = std::min(workers.size(), count - 1);
+    for (size_t i = 0; i < helpers; ++i) {
+        enqueue(run);
+    }
+    run();
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->done.wait(lock, [&state]() { return state->finished == state->count; });
+    if (state->error) {
+        std::rethrow_exception(state->error);
+    }
+}
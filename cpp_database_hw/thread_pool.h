@@ -0,0 +1,60 @@
+#pragma once
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @class ThreadPool
+ * Пул потоков с общей очередью задач.
+ */
+class ThreadPool {
+public:
+    explicit ThreadPool(size_t thread_count);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Общий пул процесса, по одному потоку на ядро.
+    static ThreadPool& shared();
+
+    size_t size() const { return workers.size(); }
+
+    // Ставит задачу в очередь; результат или исключение передаются через future.
+    template <typename F>
+    auto submit(F&& task) -> std::future<decltype(task())> {
+        using Result = decltype(task());
+        auto packaged = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(task));
+        std::future<Result> result = packaged->get_future();
+        enqueue([packaged]() { (*packaged)(); });
+        return result;
+    }
+
+    /**
+     * @brief Выполняет body(i) для всех i из [0, count) и ждёт завершения.
+     * Вызывающий поток тоже берёт номера, поэтому вложенные вызовы из задач пула не блокируются.
+     * Первое исключение из body передаётся вызывающему.
+     */
+    void parallel_for(size_t count, const std::function<void(size_t)>& body);
+
+private:
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable task_ready;
+    bool stopping = false;
+
+    void enqueue(std::function<void()> task);
+    void worker_loop();
+};
+
+#endif // THREAD_POOL_H
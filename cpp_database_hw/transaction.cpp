@@ -0,0 +1,94 @@
+#include "transaction.h"
+#include "table.h"
+#include <stdexcept>
+
+void Transaction::record_action(std::function<void()> undo) {
+    undo_actions.push_back(std::move(undo));
+    undo_log.push_back({ UndoKind::Action, nullptr, undo_actions.size() - 1 });
+}
+
+void Transaction::record_redo(std::string entry) {
+    redo_entries.push_back(std::move(entry));
+    undo_log.push_back({ UndoKind::Redo, nullptr, redo_entries.size() - 1 });
+}
+
+void Transaction::use_table(const std::shared_ptr<Table>& table) {
+    for (const auto& used : used_tables) {
+        if (used == table) {
+            return;
+        }
+    }
+    used_tables.push_back(table);
+}
+
+void Transaction::rollback_to(size_t mark) {
+    // Изменения отменяются в обратном порядке
+    while (undo_log.size() > mark) {
+        const UndoRecord& record = undo_log.back();
+        if (record.kind == UndoKind::Action) {
+            undo_actions[record.row]();
+            undo_actions.pop_back();
+        }
+        else if (record.kind == UndoKind::Redo) {
+            redo_entries.pop_back();
+        }
+        else {
+            record.table->undo_write(record.row, record.kind);
+        }
+        undo_log.pop_back();
+    }
+}
+
+void Transaction::commit(Timestamp commit_ts) {
+    for (const UndoRecord& record : undo_log) {
+        if (record.kind == UndoKind::Inserted || record.kind == UndoKind::Deleted) {
+            record.table->commit_write(record.row, record.kind, commit_ts);
+        }
+    }
+    undo_log.clear();
+    undo_actions.clear();
+    redo_entries.clear();
+    savepoints.clear();
+}
+
+size_t Transaction::find_savepoint(const std::string& name) const {
+    for (size_t i = savepoints.size(); i-- > 0;) {
+        if (savepoints[i].name == name) {
+            return i;
+        }
+    }
+    throw std::runtime_error("Savepoint not found: " + name);
+}
+
+void Transaction::savepoint(const std::string& name) {
+    savepoints.push_back({ name, mark() });
+}
+
+void Transaction::rollback_to_savepoint(const std::string& name) {
+    size_t index = find_savepoint(name);
+    rollback_to(savepoints[index].mark);
+    savepoints.resize(index + 1);
+}
+
+void Transaction::release_savepoint(const std::string& name) {
+    savepoints.resize(find_savepoint(name));
+}
+
+bool Transaction::in_nested() const {
+    for (const auto& point : savepoints) {
+        if (point.name.empty()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void Transaction::rollback_nested() {
+    size_t index = find_savepoint(std::string());
+    rollback_to(savepoints[index].mark);
+    savepoints.resize(index);
+}
+
+void Transaction::commit_nested() {
+    savepoints.resize(find_savepoint(std::string()));
+}
@@ -0,0 +1,117 @@
+#pragma once
+#ifndef TRANSACTION_H
+#define TRANSACTION_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+class Table;
+
+/**
+ * Время в MVCC: номер фиксации транзакции.
+ * Каждая версия строки хранит время начала (фиксация вставившей транзакции)
+ * и время конца (фиксация удалившей транзакции). Пока транзакция не зафиксирована,
+ * вместо времени записывается её метка: kUncommittedFlag | номер транзакции.
+ */
+using Timestamp = uint64_t;
+
+constexpr Timestamp kUncommittedFlag = uint64_t(1) << 63;
+constexpr Timestamp kInfinity = ~uint64_t(0);          ///< Конец версии, которая ещё не удалена.
+constexpr Timestamp kLatest = kUncommittedFlag - 1;    ///< Чтение последнего зафиксированного состояния.
+
+inline bool is_committed(Timestamp stamp) { return stamp < kUncommittedFlag; }
+
+/**
+ * @brief Видна ли версия [begin, end) снимку read_ts транзакции с меткой own.
+ * Свои незафиксированные изменения транзакция видит, чужие - нет.
+ */
+inline bool version_visible(Timestamp begin, Timestamp end, Timestamp read_ts, Timestamp own) {
+    bool begun = begin == own || (is_committed(begin) && begin <= read_ts);
+    bool ended = end == own || (is_committed(end) && end <= read_ts);
+    return begun && !ended;
+}
+
+/**
+ * @brief Вид записи журнала отмены.
+ */
+enum class UndoKind {
+    Inserted, ///< Создана версия строки: отмена помечает её удалённой и убирает из индексов.
+    Deleted,  ///< Завершена версия строки: отмена снимает отметку конца.
+    Action,   ///< Изменение схемы (таблица, индекс): отмена вызывает сохранённое обратное действие.
+    Redo      ///< Запись изменения схемы для журнала WAL: при откате просто отбрасывается.
+};
+
+struct UndoRecord {
+    UndoKind kind;
+    Table* table;
+    size_t row; ///< Для Action - номер обратного действия, для Redo - номер записи.
+};
+
+/**
+ * @class Transaction
+ * Снимок базы на момент начала и журнал отмены изменений.
+ * Фиксация и откат проходят только по журналу, поэтому их стоимость
+ * пропорциональна числу затронутых строк, а не размеру базы.
+ * Точки сохранения и вложенные BEGIN - позиции в журнале.
+ */
+class Transaction {
+public:
+    Transaction(uint64_t id, Timestamp read_timestamp) : transaction_id(id), read_ts(read_timestamp) {}
+
+    uint64_t id() const { return transaction_id; }
+    Timestamp read_timestamp() const { return read_ts; }
+    Timestamp stamp() const { return kUncommittedFlag | transaction_id; } ///< Метка незафиксированных версий.
+
+    bool sees(Timestamp begin, Timestamp end) const { return version_visible(begin, end, read_ts, stamp()); }
+
+    void record(Table* table, size_t row, UndoKind kind) { undo_log.push_back({ kind, table, row }); }
+    void record_action(std::function<void()> undo); // Обратное действие для изменения схемы
+    void record_redo(std::string entry);             // Изменение схемы в формате журнала WAL
+
+    // Таблицы, которые меняет транзакция: при фиксации и откате они блокируются,
+    // и живут до конца транзакции, даже если их создание откатила другая транзакция.
+    void use_table(const std::shared_ptr<Table>& table);
+    const std::vector<std::shared_ptr<Table>>& tables() const { return used_tables; }
+
+    // Журнал изменений в порядке выполнения (для записи в WAL при фиксации).
+    const std::vector<UndoRecord>& changes() const { return undo_log; }
+    const std::string& redo_entry(size_t index) const { return redo_entries[index]; }
+
+    // Позиция в журнале, до которой можно откатиться (отдельный запрос).
+    size_t mark() const { return undo_log.size(); }
+    void rollback_to(size_t mark);
+    void commit(Timestamp commit_ts);
+
+    // Именованные точки сохранения (SAVEPOINT / ROLLBACK TO / RELEASE).
+    void savepoint(const std::string& name);
+    void rollback_to_savepoint(const std::string& name); // Точка сохраняется, более поздние удаляются
+    void release_savepoint(const std::string& name);     // Изменения остаются в транзакции
+
+    // Вложенные BEGIN - безымянные точки сохранения.
+    void begin_nested() { savepoints.push_back({ std::string(), mark() }); }
+    bool in_nested() const;
+    void rollback_nested();
+    void commit_nested();
+
+private:
+    struct Savepoint {
+        std::string name; ///< Пустое имя - вложенный BEGIN.
+        size_t mark;
+    };
+
+    uint64_t transaction_id;
+    Timestamp read_ts;
+    std::vector<UndoRecord> undo_log;
+    std::vector<std::function<void()>> undo_actions;
+    std::vector<std::string> redo_entries;
+    std::vector<Savepoint> savepoints;
+    std::vector<std::shared_ptr<Table>> used_tables;
+
+    size_t find_savepoint(const std::string& name) const;
+};
+
+#endif // TRANSACTION_H
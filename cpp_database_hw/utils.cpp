@@ -4,7 +4,7 @@
 #include <stdexcept>
 
 
-//        .
+// Удаляет пробелы в начале и в конце строки.
 std::string trim(const std::string& str) {
     if (str.empty()) return str;
 
@@ -14,23 +14,23 @@ std::string trim(const std::string& str) {
     return (start < end) ? std::string(start, end) : std::string();
 }
 
-// ,     (    ).
+// Проверяет, является ли строка числом (целое или с плавающей точкой).
 bool is_numeric(const std::string& str) {
     if (str.empty()) return false;
 
     size_t start = 0;
     if (str[0] == '+' || str[0] == '-') {
-        start = 1; //  
+        start = 1; // Пропускаем знак
     }
 
     bool has_point = false;
     for (size_t i = start; i < str.size(); ++i) {
         if (str[i] == '.') {
-            if (has_point) return false; //   
+            if (has_point) return false; // Больше одной точки
             has_point = true;
         }
         else if (!std::isdigit(static_cast<unsigned char>(str[i]))) {
-            return false; //  
+            return false; // Не цифра
         }
     }
 
@@ -0,0 +1,297 @@
+#include "write_ahead_log.h"
+#include "storage_format.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace storage {
+
+namespace {
+
+constexpr size_t kWalHeaderSize = sizeof(kWalMagic) + sizeof(uint32_t);
+constexpr size_t kRecordHeaderSize = 2 * sizeof(uint64_t);
+
+std::string wal_header() {
+    std::string header(kWalMagic, sizeof(kWalMagic));
+    header.append(reinterpret_cast<const char*>(&kWalVersion), sizeof(kWalVersion));
+    return header;
+}
+
+} // namespace
+
+#ifdef _WIN32
+
+WriteAheadLog::WriteAheadLog(const std::string& filename) : filename(filename) {
+    HANDLE file = CreateFileA(filename.c_str(), GENERIC_WRITE, FILE_SHARE_READ, nullptr,
+        OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error("Failed to open write-ahead log: " + filename);
+    }
+    handle = file;
+    LARGE_INTEGER size;
+    LARGE_INTEGER zero = {};
+    if (!GetFileSizeEx(file, &size) || !SetFilePointerEx(file, zero, nullptr, FILE_END)) {
+        CloseHandle(file);
+        throw std::runtime_error("Failed to open write-ahead log: " + filename);
+    }
+    durable_bytes = static_cast<uint64_t>(size.QuadPart);
+    if (durable_bytes == 0) {
+        write_all(wal_header());
+        sync();
+        durable_bytes = kWalHeaderSize;
+    }
+}
+
+WriteAheadLog::~WriteAheadLog() {
+    CloseHandle(handle);
+}
+
+void WriteAheadLog::write_all(const std::string& bytes) {
+    size_t written = 0;
+    while (written < bytes.size()) {
+        DWORD chunk = 0;
+        DWORD request = static_cast<DWORD>(std::min<size_t>(bytes.size() - written, 1u << 30));
+        if (!WriteFile(handle, bytes.data() + written, request, &chunk, nullptr)) {
+            throw std::runtime_error("Failed to write write-ahead log: " + filename);
+        }
+        written += chunk;
+    }
+}
+
+void WriteAheadLog::sync() {
+    if (!FlushFileBuffers(handle)) {
+        throw std::runtime_error("Failed to flush write-ahead log: " + filename);
+    }
+}
+
+void sync_file(const std::string& filename) {
+    HANDLE file = CreateFileA(filename.c_str(), GENERIC_WRITE, FILE_SHARE_READ, nullptr,
+        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error("Failed to open file for flushing: " + filename);
+    }
+    bool ok = FlushFileBuffers(file) != 0;
+    CloseHandle(file);
+    if (!ok) {
+        throw std::runtime_error("Failed to flush file: " + filename);
+    }
+}
+
+void replace_file(const std::string& source, const std::string& target) {
+    if (!MoveFileExA(source.c_str(), target.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)) {
+        throw std::runtime_error("Failed to replace file: " + target);
+    }
+}
+
+#else
+
+WriteAheadLog::WriteAheadLog(const std::string& filename) : filename(filename) {
+    fd = open(filename.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (fd < 0) {
+        throw std::runtime_error("Failed to open write-ahead log: " + filename);
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        close(fd);
+        throw std::runtime_error("Failed to open write-ahead log: " + filename);
+    }
+    durable_bytes = static_cast<uint64_t>(info.st_size);
+    if (durable_bytes == 0) {
+        write_all(wal_header());
+        sync();
+        durable_bytes = kWalHeaderSize;
+    }
+}
+
+WriteAheadLog::~WriteAheadLog() {
+    close(fd);
+}
+
+void WriteAheadLog::write_all(const std::string& bytes) {
+    size_t written = 0;
+    while (written < bytes.size()) {
+        ssize_t chunk = write(fd, bytes.data() + written, bytes.size() - written);
+        if (chunk < 0) {
+            throw std::runtime_error("Failed to write write-ahead log: " + filename);
+        }
+        written += static_cast<size_t>(chunk);
+    }
+}
+
+void WriteAheadLog::sync() {
+    if (fsync(fd) != 0) {
+        throw std::runtime_error("Failed to flush write-ahead log: " + filename);
+    }
+}
+
+void sync_file(const std::string& filename) {
+    int file = open(filename.c_str(), O_RDONLY);
+    if (file < 0) {
+        throw std::runtime_error("Failed to open file for flushing: " + filename);
+    }
+    bool ok = fsync(file) == 0;
+    close(file);
+    if (!ok) {
+        throw std::runtime_error("Failed to flush file: " + filename);
+    }
+}
+
+void replace_file(const std::string& source, const std::string& target) {
+    if (std::rename(source.c_str(), target.c_str()) != 0) {
+        throw std::runtime_error("Failed to replace file: " + target);
+    }
+    // Переименование переживает сбой только после сброса каталога
+    std::string directory = std::filesystem::path(target).parent_path().string();
+    int dir = open(directory.empty() ? "." : directory.c_str(), O_RDONLY);
+    if (dir >= 0) {
+        fsync(dir);
+        close(dir);
+    }
+}
+
+#endif
+
+uint64_t WriteAheadLog::append(const std::string& record) {
+    uint64_t size = record.size();
+    uint64_t checksum = checksum64(record.data(), record.size());
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (failed) {
+        throw std::runtime_error("Write-ahead log is unusable after a write error: " + filename);
+    }
+    pending.append(reinterpret_cast<const char*>(&size), sizeof(size));
+    pending.append(reinterpret_cast<const char*>(&checksum), sizeof(checksum));
+    pending.append(record);
+    return ++appended;
+}
+
+void WriteAheadLog::wait(uint64_t sequence) {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (durable < sequence) {
+        if (failed) {
+            throw std::runtime_error("Failed to write write-ahead log: " + filename);
+        }
+        if (flushing) {
+            // Запись уйдёт на диск вместе со следующей группой
+            flushed.wait(lock);
+            continue;
+        }
+
+        // Этот поток сбрасывает на диск всё накопленное, включая записи других потоков
+        flushing = true;
+        std::string batch;
+        batch.swap(pending);
+        uint64_t batch_end = appended;
+        lock.unlock();
+        bool ok = true;
+        try {
+            write_all(batch);
+            sync();
+        }
+        catch (const std::exception&) {
+            ok = false;
+        }
+        lock.lock();
+        flushing = false;
+        if (ok) {
+            durable = batch_end;
+            durable_bytes += batch.size();
+        }
+        else {
+            failed = true;
+        }
+        flushed.notify_all();
+    }
+}
+
+uint64_t WriteAheadLog::size() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return durable_bytes;
+}
+
+std::string WriteAheadLog::read_tail(uint64_t position) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (position < kWalHeaderSize || position > durable_bytes) {
+        throw std::runtime_error("Invalid write-ahead log position.");
+    }
+    std::ifstream file(filename, std::ios::binary);
+    std::string tail(static_cast<size_t>(durable_bytes - position), '\0');
+    file.seekg(static_cast<std::streamoff>(position));
+    file.read(tail.data(), static_cast<std::streamsize>(tail.size()));
+    if (static_cast<size_t>(file.gcount()) != tail.size()) {
+        throw std::runtime_error("Failed to read write-ahead log: " + filename);
+    }
+    return tail;
+}
+
+void WriteAheadLog::reset(const std::string& filename, const std::string& records) {
+    std::string temp_filename = filename + ".tmp";
+    {
+        std::ofstream file(temp_filename, std::ios::binary | std::ios::trunc);
+        file << wal_header() << records;
+        file.close();
+        if (!file) {
+            throw std::runtime_error("Failed to write write-ahead log: " + temp_filename);
+        }
+    }
+    sync_file(temp_filename);
+    replace_file(temp_filename, filename);
+}
+
+std::vector<std::string> WriteAheadLog::read_records(const std::string& filename) {
+    std::vector<std::string> records;
+    std::ifstream file(filename, std::ios::binary);
+    if (!file.is_open()) {
+        return records;
+    }
+    std::string bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    file.close();
+    if (bytes.size() < kWalHeaderSize) {
+        return records; // Журнал не успел получить заголовок
+    }
+    uint32_t version;
+    std::memcpy(&version, bytes.data() + sizeof(kWalMagic), sizeof(version));
+    if (std::memcmp(bytes.data(), kWalMagic, sizeof(kWalMagic)) != 0 || version != kWalVersion) {
+        throw std::runtime_error("Not a supported write-ahead log: " + filename);
+    }
+
+    size_t position = kWalHeaderSize;
+    while (bytes.size() - position >= kRecordHeaderSize) {
+        uint64_t size, checksum;
+        std::memcpy(&size, bytes.data() + position, sizeof(size));
+        std::memcpy(&checksum, bytes.data() + position + sizeof(size), sizeof(checksum));
+        if (size > bytes.size() - position - kRecordHeaderSize) {
+            break;
+        }
+        const char* data = bytes.data() + position + kRecordHeaderSize;
+        if (checksum64(data, static_cast<size_t>(size)) != checksum) {
+            break;
+        }
+        records.emplace_back(data, static_cast<size_t>(size));
+        position += kRecordHeaderSize + static_cast<size_t>(size);
+    }
+
+    // Оборванная запись не была зафиксирована: отрезаем её, чтобы новые записи шли за целыми
+    if (position < bytes.size()) {
+        std::cout << "Discarding incomplete tail of write-ahead log: " << (bytes.size() - position) << " bytes.\n";
+        std::filesystem::resize_file(filename, position);
+    }
+    return records;
+}
+
+} // namespace storage
@@ -0,0 +1,84 @@
+#pragma once
+#ifndef WRITE_AHEAD_LOG_H
+#define WRITE_AHEAD_LOG_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace storage {
+
+constexpr char kWalMagic[4] = { 'C', 'P', 'W', 'L' };
+constexpr uint32_t kWalVersion = 1;
+
+/**
+ * @class WriteAheadLog
+ * Журнал упреждающей записи: файл, в который дописываются зафиксированные изменения.
+ *
+ * Файл: magic "CPWL", u32 версия, затем записи. Запись: u64 длина данных, u64 контрольная сумма, данные.
+ * Содержимое записи формирует Database. Оборванная запись в конце файла (сбой во время записи)
+ * при чтении отбрасывается.
+ *
+ * Групповая фиксация: пока один поток сбрасывает журнал на диск, записи других потоков
+ * накапливаются и уходят на диск следующим общим fsync.
+ */
+class WriteAheadLog {
+public:
+    // Открывает журнал для дописывания; нет файла - создаёт пустой.
+    explicit WriteAheadLog(const std::string& filename);
+    ~WriteAheadLog();
+
+    WriteAheadLog(const WriteAheadLog&) = delete;
+    WriteAheadLog& operator=(const WriteAheadLog&) = delete;
+
+    // Ставит запись в очередь и возвращает её номер; порядок записей в файле - порядок вызовов append.
+    uint64_t append(const std::string& record);
+    // Возвращает управление, когда запись с номером sequence на диске. Можно вызывать из разных потоков.
+    void wait(uint64_t sequence);
+    void commit(const std::string& record) { wait(append(record)); }
+
+    // Размер журнала на диске в байтах.
+    uint64_t size();
+    // Записи, начиная с позиции position, в виде байтов файла (для переноса в новый журнал).
+    std::string read_tail(uint64_t position);
+
+    // Все целые записи журнала по порядку; оборванный хвост отрезается от файла. Нет файла - нет записей.
+    static std::vector<std::string> read_records(const std::string& filename);
+
+    // Атомарно заменяет журнал новым, содержащим только переданные записи (байты из read_tail).
+    static void reset(const std::string& filename, const std::string& records);
+
+    const std::string& name() const { return filename; }
+
+private:
+    std::string filename;
+#ifdef _WIN32
+    void* handle = nullptr;
+#else
+    int fd = -1;
+#endif
+
+    std::mutex mutex;
+    std::condition_variable flushed;
+    std::string pending;       ///< Записи, ещё не переданные на диск.
+    uint64_t appended = 0;     ///< Номер последней добавленной записи.
+    uint64_t durable = 0;      ///< Номер последней записи на диске.
+    uint64_t durable_bytes = 0; ///< Размер файла с записями на диске.
+    bool flushing = false;     ///< Какой-то поток сейчас пишет на диск.
+    bool failed = false;       ///< Запись на диск не удалась: содержимое файла неизвестно.
+
+    void write_all(const std::string& bytes);
+    void sync();
+};
+
+// Сбрасывает записанный файл на диск.
+void sync_file(const std::string& filename);
+
+// Атомарно заменяет target файлом source (переименование) и сохраняет на диске запись каталога.
+void replace_file(const std::string& source, const std::string& target);
+
+} // namespace storage
+
+#endif // WRITE_AHEAD_LOG_H